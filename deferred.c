@@ -0,0 +1,119 @@
+/**
+ * @file deferred.c
+ * @brief Colas de trabajo diferido por prioridad y medición de latencia y presupuesto.
+ * 
+ * Varias interrupciones pueden encolar, por lo que `deferred_post()` escribe con las interrupciones
+ * deshabilitadas durante unos pocos ciclos; el bucle principal es el único consumidor.
+ */
+#include "deferred.h"
+#include "hardware/sync.h"
+#include "metrics.h"
+
+/**
+ * @brief Trabajo en cola.
+ */
+typedef struct {
+    uint8_t id;
+    uint32_t arg;
+    absolute_time_t posted_at;
+} DeferredItem;
+
+/**
+ * @brief Cola circular de una prioridad.
+ */
+typedef struct {
+    DeferredItem items[DEFERRED_QUEUE_SIZE];
+    volatile uint32_t head;
+    volatile uint32_t tail;
+} DeferredQueue;
+
+/**
+ * @brief Manejador registrado.
+ */
+typedef struct {
+    DeferredHandler fn;
+    DeferredPriority prio;
+    uint32_t budget_us;
+} DeferredEntry;
+
+static DeferredQueue queues[DEFERRED_PRIO_COUNT];
+static DeferredEntry handlers[DEFERRED_MAX_HANDLERS];
+static int handler_count = 0;
+static volatile uint32_t dropped = 0;
+static uint32_t overruns = 0;
+
+int deferred_register(DeferredHandler handler, DeferredPriority prio, uint32_t budget_us) {
+    if (handler_count >= DEFERRED_MAX_HANDLERS) {
+        return -1;
+    }
+    handlers[handler_count].fn = handler;
+    handlers[handler_count].prio = prio;
+    handlers[handler_count].budget_us = budget_us;
+    return handler_count++;
+}
+
+bool deferred_post(int id, uint32_t arg) {
+    DeferredQueue* q = &queues[handlers[id].prio];
+    absolute_time_t now = get_absolute_time();
+    bool ok = false;
+
+    uint32_t ints = save_and_disable_interrupts();
+    if (q->head - q->tail < DEFERRED_QUEUE_SIZE) {
+        DeferredItem* item = &q->items[q->head & (DEFERRED_QUEUE_SIZE - 1)];
+        item->id = (uint8_t)id;
+        item->arg = arg;
+        item->posted_at = now;
+        q->head++;
+        ok = true;
+    } else {
+        dropped++;
+    }
+    restore_interrupts(ints);
+    return ok;
+}
+
+/**
+ * @brief Extrae el trabajo más antiguo de la cola de mayor prioridad con trabajos.
+ */
+static bool pop_next(DeferredItem* out) {
+    for (int p = 0; p < DEFERRED_PRIO_COUNT; p++) {
+        DeferredQueue* q = &queues[p];
+        uint32_t t = q->tail;
+        if (t != q->head) {
+            __compiler_memory_barrier();
+            *out = q->items[t & (DEFERRED_QUEUE_SIZE - 1)];
+            __compiler_memory_barrier();
+            q->tail = t + 1;
+            return true;
+        }
+    }
+    return false;
+}
+
+void deferred_run() {
+    DeferredItem item;
+
+    for (int n = 0; n < DEFERRED_RUN_MAX && pop_next(&item); n++) {
+        absolute_time_t start = get_absolute_time();
+        metrics_gauge_max(GAUGE_DEFER_LATENCY_MAX_US,
+                          (uint32_t)absolute_time_diff_us(item.posted_at, start));
+
+        handlers[item.id].fn(item.arg, item.posted_at);
+
+        uint32_t exec_us = (uint32_t)absolute_time_diff_us(start, get_absolute_time());
+        metrics_gauge_max(GAUGE_DEFER_EXEC_MAX_US, exec_us);
+        if (exec_us > handlers[item.id].budget_us) {
+            metrics_gauge_set(GAUGE_DEFER_OVERRUNS, ++overruns);
+        }
+    }
+    metrics_gauge_set(GAUGE_DEFER_DROPPED, dropped);
+}
+
+bool deferred_idle() {
+    for (int p = 0; p < DEFERRED_PRIO_COUNT; p++) {
+        if (queues[p].head != queues[p].tail) {
+            return false;
+        }
+    }
+    return true;
+}
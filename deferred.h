@@ -0,0 +1,82 @@
+/**
+ * @file deferred.h
+ * @brief Trabajo diferido: las interrupciones solo marcan el tiempo y encolan.
+ * 
+ * Las rutinas de interrupción llaman a `deferred_post()` con un argumento de 32 bits; el trabajo
+ * real lo hacen manejadores registrados que se ejecutan en el bucle principal por orden de
+ * prioridad. Se mide la latencia entre la interrupción y el manejador, y el tiempo de ejecución
+ * de cada manejador frente a su presupuesto; los peores casos se publican como métricas.
+ */
+#ifndef DEFERRED_H
+#define DEFERRED_H
+
+#include "pico/stdlib.h"
+
+/**
+ * @brief Capacidad de cada cola de prioridad; debe ser potencia de 2.
+ * 
+ * Debe cubrir las teclas pulsadas durante la espera bloqueante más larga (LED de 5 s).
+ */
+#define DEFERRED_QUEUE_SIZE 32
+
+/**
+ * @brief Número máximo de manejadores registrados.
+ */
+#define DEFERRED_MAX_HANDLERS 8
+
+/**
+ * @brief Máximo de trabajos atendidos por llamada a `deferred_run()`.
+ */
+#define DEFERRED_RUN_MAX 8
+
+/**
+ * @brief Prioridades de los trabajos diferidos (menor valor, mayor prioridad).
+ */
+typedef enum {
+    DEFERRED_PRIO_HIGH,
+    DEFERRED_PRIO_LOW,
+    DEFERRED_PRIO_COUNT
+} DeferredPriority;
+
+/**
+ * @brief Manejador de un trabajo diferido.
+ * 
+ * @param arg Argumento entregado por la interrupción.
+ * @param posted_at Instante en que la interrupción encoló el trabajo.
+ */
+typedef void (*DeferredHandler)(uint32_t arg, absolute_time_t posted_at);
+
+/**
+ * @brief Registra un manejador.
+ * 
+ * @param handler Función que atiende el trabajo en el bucle principal.
+ * @param prio Prioridad del trabajo.
+ * @param budget_us Tiempo de ejecución esperado; superarlo cuenta como exceso.
+ * @return Identificador para `deferred_post()`, o -1 si no hay espacio.
+ */
+int deferred_register(DeferredHandler handler, DeferredPriority prio, uint32_t budget_us);
+
+/**
+ * @brief Encola un trabajo; seguro desde interrupciones.
+ * 
+ * @param id Identificador devuelto por `deferred_register()`.
+ * @param arg Argumento para el manejador.
+ * @return false si la cola estaba llena y el trabajo se descartó.
+ */
+bool deferred_post(int id, uint32_t arg);
+
+/**
+ * @brief Ejecuta hasta `DEFERRED_RUN_MAX` trabajos pendientes, primero los de mayor prioridad.
+ * 
+ * Debe llamarse en cada iteración del bucle principal.
+ */
+void deferred_run(void);
+
+/**
+ * @brief Indica si no queda ningún trabajo en cola.
+ * 
+ * Para que el resultado siga valiendo, debe llamarse con las interrupciones deshabilitadas.
+ */
+bool deferred_idle(void);
+
+#endif // DEFERRED_H
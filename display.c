@@ -0,0 +1,331 @@
+/**
+ * @file display.c
+ * @brief Búfer de imagen, seguimiento de filas modificadas y codificación serie del ST7920.
+ * 
+ * `fb` es lo que debe verse y `shown` lo que ya se envió al panel. Cambiar una fila de `fb` la marca;
+ * al enviarla se compara con `shown` y solo se transmite el tramo que cambió, alineado a pares de
+ * celdas porque el ST7920 direcciona la memoria de texto en palabras de dos caracteres. Una
+ * pantalla nueva solo marca las filas que difieren de la anterior.
+ */
+#include "display.h"
+#include <string.h>
+
+/**
+ * @brief Byte de sincronía del ST7920 para instrucciones.
+ */
+#define ST7920_SYNC_CMD 0xF8
+
+/**
+ * @brief Byte de sincronía del ST7920 para datos.
+ */
+#define ST7920_SYNC_DATA 0xFA
+
+/**
+ * @brief Dirección de memoria de texto del inicio de cada fila.
+ */
+static const uint8_t row_address[DISPLAY_ROWS] = {0x80, 0x90, 0x88, 0x98};
+
+static char fb[DISPLAY_ROWS][DISPLAY_COLS];
+static char shown[DISPLAY_ROWS][DISPLAY_COLS];
+static volatile uint8_t dirty_rows = 0;
+static volatile bool busy = false;
+static uint8_t tx[DISPLAY_TX_MAX];
+
+static int cursor_row = 0;
+static int cursor_col = 0;
+static uint8_t utf8_lead = 0;
+
+static uint32_t burst_bytes = 0;
+static DisplayStats stats;
+
+/**
+ * @brief Agrega un byte en el formato serie del ST7920 (nibble alto y nibble bajo, cada uno
+ * en los 4 bits superiores).
+ */
+static inline size_t put_serial(size_t n, uint8_t b) {
+    tx[n++] = b & 0xF0;
+    tx[n++] = (uint8_t)(b << 4);
+    return n;
+}
+
+/**
+ * @brief Busca la siguiente fila con cambios, la codifica en `tx` e inicia su envío.
+ * 
+ * Se ejecuta con el puerto bloqueado o desde la interrupción de fin de transferencia.
+ * 
+ * @return true si se inició una transferencia.
+ */
+static bool start_next(void) {
+    while (dirty_rows) {
+        int row = 0;
+        while (!(dirty_rows & (1u << row))) {
+            row++;
+        }
+        dirty_rows &= ~(1u << row);
+
+        int first = 0;
+        while (first < DISPLAY_COLS && fb[row][first] == shown[row][first]) {
+            first++;
+        }
+        if (first == DISPLAY_COLS) {
+            continue;
+        }
+        int last = DISPLAY_COLS - 1;
+        while (fb[row][last] == shown[row][last]) {
+            last--;
+        }
+        first &= ~1;
+        last |= 1;
+
+        size_t n = 0;
+        tx[n++] = ST7920_SYNC_CMD;
+        n = put_serial(n, row_address[row] + first / 2);
+        tx[n++] = ST7920_SYNC_DATA;
+        for (int col = first; col <= last; col++) {
+            shown[row][col] = fb[row][col];
+            n = put_serial(n, (uint8_t)shown[row][col]);
+        }
+
+        burst_bytes += n;
+        stats.bytes_total += n;
+        display_port_start(tx, n);
+        return true;
+    }
+
+    if (burst_bytes) {
+        stats.updates++;
+        stats.last_update_bytes = burst_bytes;
+        if (burst_bytes > stats.max_update_bytes) {
+            stats.max_update_bytes = burst_bytes;
+        }
+        burst_bytes = 0;
+    }
+    return false;
+}
+
+/**
+ * @brief Inicia el envío si el bus está libre.
+ */
+static void kick(void) {
+    uint32_t state = display_port_lock();
+    if (!busy) {
+        busy = start_next();
+    }
+    display_port_unlock(state);
+}
+
+void display_port_done() {
+    busy = start_next();
+}
+
+/**
+ * @brief Escribe un carácter imprimible en la posición del cursor; fuera del panel se descarta.
+ */
+static void put_cell(char c) {
+    if (cursor_col == DISPLAY_COLS && cursor_row < DISPLAY_ROWS - 1) {
+        cursor_row++;
+        cursor_col = 0;
+    }
+    if (cursor_col == DISPLAY_COLS) {
+        return;
+    }
+    if (fb[cursor_row][cursor_col] != c) {
+        fb[cursor_row][cursor_col] = c;
+        dirty_rows |= 1u << cursor_row;
+    }
+    cursor_col++;
+}
+
+/**
+ * @brief Equivalente ASCII de un carácter Latin-1 (0xC0-0xFF); el panel solo tiene ASCII.
+ */
+static char fold_latin1(uint8_t c) {
+    static const char map[64] =
+        "AAAAAAACEEEEIIII" "DNOOOOOxOUUUUYPs"
+        "aaaaaaaceeeeiiii" "dnooooo/ouuuuypy";
+    return map[c - 0xC0];
+}
+
+/**
+ * @brief Decodifica un byte UTF-8 a una celda del panel.
+ * 
+ * @param c Byte de entrada.
+ * @param lead Byte inicial pendiente de una secuencia de dos bytes (0 si no hay).
+ * @return Carácter a mostrar, `\n`, o 0 si el byte no produce ninguno.
+ */
+static char decode_byte(uint8_t c, uint8_t* lead) {
+    if (*lead) {
+        uint8_t first = *lead;
+        *lead = 0;
+        if ((c & 0xC0) == 0x80) {
+            if (first == 0xC3) {
+                return fold_latin1(c + 0x40);
+            }
+            if (first == 0xC2 && (c == 0xA1 || c == 0xBF)) {
+                return c == 0xA1 ? '!' : '?';
+            }
+            return '?';
+        }
+    }
+    if (c >= 0xC0) {
+        *lead = c;
+        return 0;
+    }
+    if (c == '\n' || (c >= 0x20 && c < 0x7F)) {
+        return (char)c;
+    }
+    return 0;
+}
+
+/**
+ * @brief Dispone texto ya decodificado en filas de `DISPLAY_COLS` cortando entre palabras.
+ * 
+ * @param s Texto ASCII con `\n` como fin de fila.
+ * @param n Longitud.
+ * @param rows Destino, `DISPLAY_ROWS` filas ya en blanco; lo que no cabe se descarta.
+ * @param end_row Fila donde queda el cursor.
+ * @param end_col Columna donde queda el cursor.
+ * @param clean Se pone en false si hubo que partir una palabra o recortar.
+ * @return Filas que ocupa el texto, incluida la fila de entrada de un `\n` final (puede superar
+ *         `DISPLAY_ROWS`).
+ */
+static int layout(const char* s, size_t n, char rows[DISPLAY_ROWS][DISPLAY_COLS], int* end_row,
+                  int* end_col, bool* clean) {
+    int row = 0;
+    int col = 0;
+    size_t i = 0;
+    while (i < n) {
+        if (s[i] == '\n') {
+            row++;
+            col = 0;
+            i++;
+            continue;
+        }
+        int gap = 0;
+        while (i < n && s[i] == ' ') {
+            gap++;
+            i++;
+        }
+        size_t word = i;
+        while (i < n && s[i] != ' ' && s[i] != '\n') {
+            i++;
+        }
+        int len = (int)(i - word);
+        if (len == 0) {
+            continue;                               // espacios al final de la fila
+        }
+        if (col > 0 && col + gap + len > DISPLAY_COLS) {
+            row++;                                  // la palabra pasa entera a la fila siguiente
+            col = 0;
+        } else if (col > 0) {
+            col += gap;                             // se respetan los espacios dentro de la fila
+        }
+        if (len > DISPLAY_COLS) {
+            *clean = false;                         // más larga que una fila: se parte
+        }
+        for (int k = 0; k < len; k++, col++) {
+            if (col == DISPLAY_COLS) {
+                row++;
+                col = 0;
+            }
+            if (row < DISPLAY_ROWS) {
+                rows[row][col] = s[word + k];
+            }
+        }
+    }
+    int used = (col > 0 || (n > 0 && s[n - 1] == '\n')) ? row + 1 : row;
+    if (used > DISPLAY_ROWS) {
+        *clean = false;
+    }
+    *end_row = row;
+    *end_col = col;
+    return used;
+}
+
+bool display_show(DisplayMode mode, const char* text, size_t len) {
+    char s[DISPLAY_ROWS * (DISPLAY_COLS + 1) * 2];
+    size_t n = 0;
+    uint8_t lead = 0;
+    bool clean = true;
+    for (size_t i = 0; i < len; i++) {
+        char c = decode_byte((uint8_t)text[i], &lead);
+        if (c && n < sizeof(s)) {
+            s[n++] = c;
+        } else if (c) {
+            clean = false;
+        }
+    }
+
+    char rows[DISPLAY_ROWS][DISPLAY_COLS];
+    int end_row, end_col;
+    memset(rows, ' ', sizeof(rows));
+    int used = layout(s, n, rows, &end_row, &end_col, &clean);
+
+    // Debajo de lo mostrado solo si cabe entero; si no, se empieza por la primera fila
+    int first = 0;
+    if (mode == DISPLAY_BELOW) {
+        int shown_rows = cursor_col > 0 ? cursor_row + 1 : cursor_row;
+        if (shown_rows + used <= DISPLAY_ROWS) {
+            first = shown_rows;
+        }
+    }
+    for (int r = first; r < DISPLAY_ROWS; r++) {
+        const char* src = rows[r - first];
+        if (memcmp(fb[r], src, DISPLAY_COLS) != 0) {
+            memcpy(fb[r], src, DISPLAY_COLS);
+            dirty_rows |= 1u << r;
+        }
+    }
+
+    cursor_row = first + end_row;
+    cursor_col = end_col;
+    if (cursor_row >= DISPLAY_ROWS) {
+        cursor_row = DISPLAY_ROWS - 1;              // sin lugar para la entrada: el eco se descarta
+        cursor_col = DISPLAY_COLS;
+    }
+    utf8_lead = 0;
+    kick();
+    return clean;
+}
+
+void display_write(const char* text, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        char c = decode_byte((uint8_t)text[i], &utf8_lead);
+        if (c == '\n') {
+            if (cursor_row < DISPLAY_ROWS - 1) {
+                cursor_row++;
+                cursor_col = 0;
+            } else {
+                cursor_col = DISPLAY_COLS;
+            }
+        } else if (c) {
+            put_cell(c);
+        }
+    }
+    kick();
+}
+
+void display_clear() {
+    memset(fb, ' ', sizeof(fb));
+    dirty_rows = (1u << DISPLAY_ROWS) - 1;
+    cursor_row = 0;
+    cursor_col = 0;
+    utf8_lead = 0;
+    kick();
+}
+
+void display_get_stats(DisplayStats* out) {
+    uint32_t state = display_port_lock();
+    *out = stats;
+    display_port_unlock(state);
+}
+
+const char* display_row(int row) {
+    return fb[row];
+}
+
+void display_init() {
+    memset(fb, ' ', sizeof(fb));
+    memset(shown, ' ', sizeof(shown));
+    display_port_init();
+}
@@ -0,0 +1,163 @@
+/**
+ * @file display.h
+ * @brief Pantalla LCD de caracteres (ST7920 en modo serie, 16x4) con búfer de imagen y envío por DMA.
+ * 
+ * Cada mensaje se dispone como una pantalla de 16x4: sus filas se cortan entre palabras y no hay
+ * desplazamiento, así que lo que el usuario debe ver sigue en su lugar mientras teclea. La imagen
+ * se arma en un búfer en RAM sin esperar al bus. Cada fila lleva una marca de cambio; al enviarla
+ * solo se transmite el tramo de celdas que difiere de lo que muestra el panel (en la práctica, el
+ * eco de cada tecla y las filas que cambian entre dos pantallas). Las transferencias las realiza el puerto de hardware (`display_port_*`) y al terminar
+ * cada una se encadena la siguiente fila pendiente, sin intervención del bucle principal.
+ * 
+ * Este módulo no depende del SDK para poder compilarse también en el anfitrión con un puerto
+ * simulado (ver `tools/display_sim.c`).
+ */
+#ifndef DISPLAY_H
+#define DISPLAY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Columnas de texto del panel.
+ */
+#define DISPLAY_COLS 16
+
+/**
+ * @brief Filas de texto del panel.
+ */
+#define DISPLAY_ROWS 4
+
+/**
+ * @brief Pin de reloj SPI (SPI1 SCK).
+ */
+#define DISPLAY_PIN_SCK 14
+
+/**
+ * @brief Pin de datos SPI (SPI1 TX).
+ */
+#define DISPLAY_PIN_MOSI 15
+
+/**
+ * @brief Pin de selección del ST7920 (activo en alto).
+ */
+#define DISPLAY_PIN_CS 13
+
+/**
+ * @brief Velocidad del bus; a 200 kHz cada carácter (16 bits) dura más que los 72 µs que el
+ * controlador necesita para procesarlo.
+ */
+#define DISPLAY_SPI_BAUD 200000
+
+/**
+ * @brief Tamaño máximo de una transferencia: dirección (3 bytes), sincronía de datos y 2 bytes por celda.
+ */
+#define DISPLAY_TX_MAX (3 + 1 + 2 * DISPLAY_COLS)
+
+/**
+ * @brief Ubicación de un mensaje en el panel.
+ */
+typedef enum {
+    DISPLAY_SCREEN,   /**< Borra el panel y empieza en la primera fila */
+    DISPLAY_BELOW,    /**< Sigue debajo de lo mostrado (un aviso previo queda visible); si no cabe, borra */
+} DisplayMode;
+
+/**
+ * @brief Estadísticas de transferencia.
+ * 
+ * Una actualización es la ráfaga de transferencias entre que el panel queda desactualizado y
+ * vuelve a coincidir con el búfer de imagen.
+ */
+typedef struct {
+    uint32_t bytes_total;        /**< Bytes enviados desde el arranque */
+    uint32_t updates;            /**< Actualizaciones completadas */
+    uint32_t last_update_bytes;  /**< Bytes de la última actualización */
+    uint32_t max_update_bytes;   /**< Bytes de la actualización más grande */
+} DisplayStats;
+
+/**
+ * @brief Inicializa el puerto de hardware y deja el panel en blanco.
+ */
+void display_init(void);
+
+/**
+ * @brief Muestra un mensaje dispuesto para el panel.
+ * 
+ * Cada `\n` termina una fila y las filas de más de `DISPLAY_COLS` caracteres se cortan entre
+ * palabras. Un `\n` final deja una fila vacía para la entrada, donde queda el cursor. Las filas
+ * del panel que el mensaje no ocupa se borran.
+ * 
+ * Solo modifica el búfer de imagen e inicia el envío si el bus está libre; nunca espera.
+ * 
+ * @param mode Ubicación del mensaje.
+ * @param text Texto UTF-8 (las letras acentuadas se muestran sin tilde).
+ * @param len Longitud en bytes.
+ * @return false si hubo que partir una palabra o el texto no cupo y se recortó.
+ */
+bool display_show(DisplayMode mode, const char* text, size_t len);
+
+/**
+ * @brief Escribe texto en la posición del cursor, para el eco de las teclas.
+ * 
+ * `\n` pasa a la fila siguiente; al llegar al final de la última fila el resto se descarta (el
+ * panel no se desplaza). Solo modifica el búfer de imagen e inicia el envío si el bus está libre.
+ * 
+ * @param text Texto a escribir.
+ * @param len Longitud en bytes.
+ */
+void display_write(const char* text, size_t len);
+
+/**
+ * @brief Borra la pantalla y vuelve el cursor al inicio.
+ */
+void display_clear(void);
+
+/**
+ * @brief Copia las estadísticas de transferencia.
+ * 
+ * @param out Destino.
+ */
+void display_get_stats(DisplayStats* out);
+
+/**
+ * @brief Contenido actual del búfer de imagen (lo que el panel mostrará al terminar el envío).
+ * 
+ * @param row Fila.
+ * @return Puntero a `DISPLAY_COLS` caracteres, sin terminador.
+ */
+const char* display_row(int row);
+
+/**
+ * @brief Debe llamarlo el puerto al terminar cada transferencia (desde su interrupción).
+ */
+void display_port_done(void);
+
+/**
+ * @brief Prepara el bus y envía la secuencia de inicialización del controlador (bloqueante).
+ */
+void display_port_init(void);
+
+/**
+ * @brief Inicia una transferencia sin esperar; el puerto llama a `display_port_done()` al terminar.
+ * 
+ * @param data Bytes a enviar; deben seguir siendo válidos hasta `display_port_done()`.
+ * @param len Cantidad de bytes.
+ */
+void display_port_start(const uint8_t* data, size_t len);
+
+/**
+ * @brief Impide que `display_port_done()` se ejecute mientras el llamador decide si iniciar un envío.
+ * 
+ * @return Estado a entregar a `display_port_unlock()`.
+ */
+uint32_t display_port_lock(void);
+
+/**
+ * @brief Deshace `display_port_lock()`.
+ * 
+ * @param state Valor devuelto por `display_port_lock()`.
+ */
+void display_port_unlock(uint32_t state);
+
+#endif // DISPLAY_H
@@ -0,0 +1,84 @@
+/**
+ * @file display_spi.c
+ * @brief Puerto de la pantalla para el RP2040: SPI1 alimentado por un canal DMA.
+ * 
+ * Cada transferencia la hace el DMA marcado por la petición de transmisión del SPI; su interrupción
+ * de fin encadena la siguiente fila pendiente, de modo que la pantalla se actualiza aunque el bucle
+ * principal esté ocupado.
+ */
+#include "display.h"
+#include "pico/stdlib.h"
+#include "hardware/spi.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "hardware/sync.h"
+#include "metrics.h"
+#include "memstat.h"
+
+/**
+ * @brief Canal DMA reservado para la pantalla.
+ */
+static int dma_chan = -1;
+
+/**
+ * @brief Interrupción de fin de transferencia del DMA.
+ */
+static void display_dma_irq(void) {
+    memstat_isr_sample(MEMSTAT_ISR_DMA);
+    dma_channel_acknowledge_irq0(dma_chan);
+    display_port_done();
+
+    DisplayStats stats;
+    display_get_stats(&stats);
+    metrics_gauge_set(GAUGE_DISPLAY_BYTES, stats.bytes_total);
+    metrics_gauge_set(GAUGE_DISPLAY_UPDATE_MAX_BYTES, stats.max_update_bytes);
+}
+
+/**
+ * @brief Envía una instrucción al ST7920 sin DMA (solo durante la inicialización).
+ */
+static void send_command_blocking(uint8_t cmd, uint32_t wait_us) {
+    const uint8_t frame[3] = {0xF8, cmd & 0xF0, (uint8_t)(cmd << 4)};
+    spi_write_blocking(spi1, frame, sizeof(frame));
+    sleep_us(wait_us);
+}
+
+void display_port_init() {
+    spi_init(spi1, DISPLAY_SPI_BAUD);
+    spi_set_format(spi1, 8, SPI_CPOL_1, SPI_CPHA_1, SPI_MSB_FIRST);
+    gpio_set_function(DISPLAY_PIN_SCK, GPIO_FUNC_SPI);
+    gpio_set_function(DISPLAY_PIN_MOSI, GPIO_FUNC_SPI);
+    gpio_init(DISPLAY_PIN_CS);
+    gpio_set_dir(DISPLAY_PIN_CS, GPIO_OUT);
+    gpio_put(DISPLAY_PIN_CS, 1);   /**< Único dispositivo en el bus: seleccionado siempre */
+
+    sleep_ms(40);                       /**< Estabilización del controlador tras el encendido */
+    send_command_blocking(0x30, 100);   /**< Juego de instrucciones básico */
+    send_command_blocking(0x0C, 100);   /**< Pantalla encendida, sin cursor */
+    send_command_blocking(0x01, 2000);  /**< Borrado (1,6 ms) */
+    send_command_blocking(0x06, 100);   /**< Dirección de escritura creciente */
+
+    dma_chan = dma_claim_unused_channel(true);
+    dma_channel_config c = dma_channel_get_default_config(dma_chan);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_8);
+    channel_config_set_dreq(&c, spi_get_dreq(spi1, true));
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, false);
+    dma_channel_configure(dma_chan, &c, &spi_get_hw(spi1)->dr, NULL, 0, false);
+
+    dma_channel_set_irq0_enabled(dma_chan, true);
+    irq_set_exclusive_handler(DMA_IRQ_0, display_dma_irq);
+    irq_set_enabled(DMA_IRQ_0, true);
+}
+
+void display_port_start(const uint8_t* data, size_t len) {
+    dma_channel_transfer_from_buffer_now(dma_chan, data, len);
+}
+
+uint32_t display_port_lock() {
+    return save_and_disable_interrupts();
+}
+
+void display_port_unlock(uint32_t state) {
+    restore_interrupts(state);
+}
@@ -0,0 +1,40 @@
+/**
+ * @file flash_layout.h
+ * @brief Distribución de las regiones de datos al final de la memoria flash.
+ * 
+ * El programa ocupa el inicio de la flash; las regiones de datos se ubican al final, alineadas a
+ * bloques de 64 KB para poder borrarlas con el comando de borrado por bloque. `flash_layout.ld`
+ * hace fallar el enlace si la imagen del programa llega a `FLASH_JOURNAL_OFFSET`.
+ */
+#ifndef FLASH_LAYOUT_H
+#define FLASH_LAYOUT_H
+
+#include "pico/stdlib.h"
+#include "hardware/flash.h"
+
+/**
+ * @brief Tamaño de un bloque de borrado rápido.
+ */
+#define FLASH_BLOCK_BYTES (64u * 1024u)
+
+/**
+ * @brief Tamaño de cada uno de los dos bancos de cuentas aprovisionadas.
+ */
+#define FLASH_PROVISION_BANK_SIZE (512u * 1024u)
+
+/**
+ * @brief Desplazamiento (desde el inicio de la flash) del banco A; el banco B le sigue.
+ */
+#define FLASH_PROVISION_OFFSET (PICO_FLASH_SIZE_BYTES - 2u * FLASH_PROVISION_BANK_SIZE)
+
+/**
+ * @brief Tamaño de la región circular del diario de eventos.
+ */
+#define FLASH_JOURNAL_SIZE (256u * 1024u)
+
+/**
+ * @brief Desplazamiento del diario: justo debajo de los bancos de cuentas.
+ */
+#define FLASH_JOURNAL_OFFSET (FLASH_PROVISION_OFFSET - FLASH_JOURNAL_SIZE)
+
+#endif // FLASH_LAYOUT_H
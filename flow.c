@@ -0,0 +1,83 @@
+/**
+ * @file flow.c
+ * @brief Lector de teclas con plazo y planificador de flujos.
+ */
+#include "flow.h"
+#include "messages.h"
+
+/**
+ * @brief Flujo registrado en el planificador.
+ */
+typedef struct {
+    FlowFn fn;
+    void* ctx;
+} Flow;
+
+static Flow flows[FLOW_MAX];
+static int flow_count = 0;
+
+void input_reader_setup(InputReader* r, char* buf, uint8_t len, bool masked,
+                        uint32_t timeout_ms, bool from_first_key) {
+    r->buf = buf;
+    r->len = len;
+    r->masked = masked;
+    r->timeout_ms = timeout_ms;
+    r->from_first_key = from_first_key;
+    r->validate = NULL;
+}
+
+void input_reader_set_validator(InputReader* r, InputValidator validate) {
+    r->validate = validate;
+}
+
+PT_THREAD(input_read(InputReader* r, const KeyEvent* ev)) {
+    PT_BEGIN(&r->pt);
+
+    r->count = 0;
+    r->armed = !r->from_first_key;
+    r->deadline = make_timeout_time_ms(r->timeout_ms);
+
+    while (r->count < r->len) {
+        PT_YIELD_UNTIL(&r->pt, ev != NULL || (r->armed && time_reached(r->deadline)));
+        if (ev == NULL) {
+            r->buf[r->count] = '\0';
+            r->status = INPUT_TIMEOUT;
+            PT_EXIT(&r->pt);
+        }
+        if (!r->armed) {
+            r->armed = true;
+            r->deadline = make_timeout_time_ms(r->timeout_ms);
+        }
+        r->buf[r->count++] = ev->key;
+        msg_echo(r->masked ? '*' : ev->key);
+        if (r->validate && !r->validate(r->buf, r->count)) {
+            r->buf[r->count] = '\0';
+            r->status = INPUT_REJECTED;
+            PT_EXIT(&r->pt);
+        }
+    }
+
+    r->buf[r->count] = '\0';
+    r->status = INPUT_OK;
+    PT_END(&r->pt);
+}
+
+bool flow_register(FlowFn fn, void* ctx) {
+    if (flow_count >= FLOW_MAX) {
+        return false;
+    }
+    flows[flow_count].fn = fn;
+    flows[flow_count].ctx = ctx;
+    flow_count++;
+    return true;
+}
+
+void flow_run(const KeyEvent* ev) {
+    for (int i = 0; i < flow_count; ) {
+        if (PT_SCHEDULE(flows[i].fn(flows[i].ctx, ev))) {
+            i++;
+        } else {
+            flows[i] = flows[--flow_count];      // flujo terminado: ocupa su lugar el último
+        }
+    }
+}
@@ -0,0 +1,106 @@
+/**
+ * @file flow.h
+ * @brief Flujos de sesión sobre protohilos: lectura de entradas con plazo y planificador.
+ * 
+ * Un flujo es un protohilo que se reanuda con cada tecla (`ev` distinto de NULL) o con cada
+ * iteración del bucle principal (`ev` NULL) para vigilar plazos. Ningún flujo usa memoria
+ * dinámica: su estado vive en una estructura de contexto estática.
+ */
+#ifndef FLOW_H
+#define FLOW_H
+
+#include "pico/stdlib.h"
+#include "pt.h"
+#include "keybuf.h"
+
+/**
+ * @brief Número máximo de flujos registrados a la vez.
+ */
+#define FLOW_MAX 4
+
+/**
+ * @brief Resultado de una lectura de entrada.
+ */
+typedef enum {
+    INPUT_OK,        /**< Se leyeron todas las teclas */
+    INPUT_TIMEOUT,   /**< Se venció el plazo */
+    INPUT_REJECTED   /**< El validador rechazó lo ingresado hasta ahora */
+} InputStatus;
+
+/**
+ * @brief Validador llamado tras cada tecla con lo leído hasta el momento.
+ * 
+ * @param buf Teclas leídas (sin terminador).
+ * @param count Cantidad de teclas leídas.
+ * @return false para cortar la lectura con `INPUT_REJECTED`.
+ */
+typedef bool (*InputValidator)(const char* buf, uint8_t count);
+
+/**
+ * @brief Protohilo que lee un número fijo de teclas con plazo.
+ */
+typedef struct {
+    struct pt pt;                  /**< Estado del protohilo */
+    char* buf;                     /**< Destino (longitud `len + 1`) */
+    uint8_t len;                   /**< Teclas a leer */
+    uint8_t count;                 /**< Teclas leídas */
+    bool masked;                   /**< Eco con '*' en lugar de la tecla */
+    bool from_first_key;           /**< El plazo empieza con la primera tecla */
+    bool armed;                    /**< El plazo está corriendo */
+    uint32_t timeout_ms;           /**< Plazo del paso */
+    absolute_time_t deadline;      /**< Instante en que vence el plazo */
+    InputValidator validate;       /**< Validador por tecla, o NULL */
+    InputStatus status;            /**< Resultado al terminar */
+} InputReader;
+
+/**
+ * @brief Función de un flujo: recibe su contexto y la tecla actual (o NULL).
+ */
+typedef PT_THREAD((*FlowFn)(void* ctx, const KeyEvent* ev));
+
+/**
+ * @brief Configura un lector antes de iniciarlo con `PT_SPAWN`.
+ * 
+ * @param r Lector.
+ * @param buf Destino de las teclas, con espacio para el terminador.
+ * @param len Número de teclas a leer.
+ * @param masked true para hacer eco con '*'.
+ * @param timeout_ms Plazo del paso en milisegundos.
+ * @param from_first_key true si el plazo empieza con la primera tecla y no al mostrar el indicador.
+ */
+void input_reader_setup(InputReader* r, char* buf, uint8_t len, bool masked,
+                        uint32_t timeout_ms, bool from_first_key);
+
+/**
+ * @brief Asigna un validador por tecla a un lector ya configurado.
+ * 
+ * @param r Lector.
+ * @param validate Validador, o NULL para aceptar cualquier tecla.
+ */
+void input_reader_set_validator(InputReader* r, InputValidator validate);
+
+/**
+ * @brief Protohilo de lectura: termina con `status` en `INPUT_OK`, `INPUT_TIMEOUT` o `INPUT_REJECTED`.
+ * 
+ * @param r Lector configurado.
+ * @param ev Tecla actual o NULL.
+ */
+PT_THREAD(input_read(InputReader* r, const KeyEvent* ev));
+
+/**
+ * @brief Registra un flujo en el planificador.
+ * 
+ * @param fn Función del flujo.
+ * @param ctx Contexto del flujo (su primer campo suele ser `struct pt`).
+ * @return false si no hay espacio.
+ */
+bool flow_register(FlowFn fn, void* ctx);
+
+/**
+ * @brief Reanuda todos los flujos registrados; los que terminan se retiran.
+ * 
+ * @param ev Tecla a entregar, o NULL para solo avanzar plazos.
+ */
+void flow_run(const KeyEvent* ev);
+
+#endif // FLOW_H
@@ -0,0 +1,258 @@
+/**
+ * @file irqlog.c
+ * @brief Grabación de interrupciones en RAM y exportación por USB.
+ * 
+ * Los deltas se calculan contra el reloj que reconstruirá el reproductor (`log_clock`), no contra
+ * el instante real del último disparo de una racha, para que el error de tiempo no se acumule.
+ * 
+ * `head` cuenta las palabras escritas desde el inicio de la grabación; la palabra `p` vive en
+ * `words[p % IRQLOG_WORDS]` y sigue retenida mientras `head - p <= IRQLOG_WORDS`.
+ */
+#include "irqlog.h"
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+#include "tcl.h"
+#include "deferred.h"
+#include "usb_cmd.h"
+
+#define WORD_MASK (IRQLOG_WORDS - 1)
+#define EXPORT_CHUNK_WORDS 64
+
+/**
+ * @brief Punto del registro desde el que se puede reproducir.
+ */
+typedef struct {
+    uint32_t pos;           /**< Primera palabra tras el punto */
+    uint64_t clock;         /**< `log_clock` en el punto */
+    uint64_t last_key_us;   /**< `last_key_time` en el punto */
+    uint8_t row;            /**< `current_row` en el punto */
+} IrqLogSnapshot;
+
+static uint32_t words[IRQLOG_WORDS];
+static uint32_t head = 0;
+static bool recording = false;
+static bool restart_pending = false;
+static bool from_boot = false;      /**< La palabra 0 sigue retenida y parte del arranque */
+static bool scan_idle = false;      /**< El último escaneo vio las columnas en alto */
+static uint8_t flags = 0;
+static uint64_t start_us = 0;
+static uint64_t log_clock = 0;
+static bool run_open = false;
+static IrqLogSnapshot snapshots[IRQLOG_SNAPSHOTS];
+static uint32_t snapshot_count = 0;
+
+/**
+ * @brief Agrega una palabra; si el registro está lleno, sobrescribe la más antigua.
+ */
+static void put(uint32_t word) {
+    if (head == IRQLOG_WORDS) {
+        from_boot = false;
+    }
+    words[head++ & WORD_MASK] = word;
+}
+
+/**
+ * @brief Agrega un evento en `now`, con palabras de avance si el hueco no cabe en el delta.
+ */
+static void append(IrqLogType type, uint32_t data, uint64_t now) {
+    uint64_t delta = now > log_clock ? now - log_clock : 0;
+    while (delta > IRQLOG_DELTA_MAX) {
+        put(IRQLOG_WORD(IRQLOG_TIME, 0, IRQLOG_DELTA_MAX));
+        delta -= IRQLOG_DELTA_MAX;
+        log_clock += IRQLOG_DELTA_MAX;
+    }
+    put(IRQLOG_WORD(type, data, delta));
+    log_clock += delta;
+}
+
+/**
+ * @brief Instantánea retenida más antigua que no se sobrescribirá durante una exportación.
+ * 
+ * @param n Palabras escritas al empezar la exportación.
+ * @return NULL si no queda ninguna.
+ */
+static const IrqLogSnapshot* oldest_snapshot(uint32_t n) {
+    uint32_t first = snapshot_count > IRQLOG_SNAPSHOTS ? snapshot_count - IRQLOG_SNAPSHOTS : 0;
+    for (uint32_t i = first; i < snapshot_count; i++) {
+        const IrqLogSnapshot* s = &snapshots[i % IRQLOG_SNAPSHOTS];
+        if (n - s->pos + IRQLOG_EXPORT_MARGIN <= IRQLOG_WORDS) {
+            return s;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Elige el inicio de la exportación: el arranque si sigue retenido, si no la instantánea
+ * más antigua.
+ * 
+ * @param n Palabras escritas al empezar la exportación.
+ * @param start Destino del punto de inicio.
+ * @param start_flags Destino de los indicadores de la cabecera.
+ * @return false si no hay ningún punto reproducible retenido.
+ */
+static bool export_start(uint32_t n, IrqLogSnapshot* start, uint8_t* start_flags) {
+    const IrqLogSnapshot* s = oldest_snapshot(n);
+    bool boot_kept = from_boot && n + IRQLOG_EXPORT_MARGIN <= IRQLOG_WORDS;
+    if (boot_kept && !(s && (flags & IRQLOG_FLAG_RESUMED))) {
+        *start = (IrqLogSnapshot){.pos = 0, .clock = start_us, .last_key_us = start_us, .row = 0};
+        *start_flags = flags;
+        return true;
+    }
+    if (s) {
+        *start = *s;
+        *start_flags = IRQLOG_FLAG_SNAPSHOT;
+        return true;
+    }
+    return false;
+}
+
+void irqlog_init(bool resumed) {
+    head = 0;
+    snapshot_count = 0;
+    run_open = false;
+    restart_pending = false;
+    from_boot = true;
+    flags = resumed ? IRQLOG_FLAG_RESUMED : 0;
+    start_us = time_us_64();
+    log_clock = start_us;
+    recording = true;
+}
+
+void irqlog_key_edge(uint32_t gpio, uint8_t row) {
+    scan_idle = false;
+    if (!recording) {
+        return;
+    }
+    uint32_t ints = save_and_disable_interrupts();
+    run_open = false;
+    append(IRQLOG_KEY_EDGE, (gpio & 0x1F) | ((uint32_t)(row & 0x03) << 5), time_us_64());
+    restore_interrupts(ints);
+}
+
+void irqlog_alarm(uint8_t col_levels, uint8_t row) {
+    scan_idle = col_levels == IRQLOG_COLS_IDLE;
+    if (!recording) {
+        return;
+    }
+    uint32_t ints = save_and_disable_interrupts();
+    uint64_t now = time_us_64();
+    uint32_t* last = &words[(head - 1) & WORD_MASK];
+    if (!scan_idle) {
+        run_open = false;
+        append(IRQLOG_ALARM, (col_levels & 0x0F) | ((uint32_t)(row & 0x03) << 4), now);
+    } else if (run_open && IRQLOG_DATA(*last) < 0xFF) {
+        *last = IRQLOG_WORD(IRQLOG_ALARM_RUN, IRQLOG_DATA(*last) + 1, IRQLOG_DELTA(*last));
+        log_clock += KEYPAD_SCAN_PERIOD_MS * 1000u;
+    } else {
+        append(IRQLOG_ALARM_RUN, 1, now);
+        run_open = true;
+    }
+    restore_interrupts(ints);
+}
+
+void irqlog_idle() {
+    if (!recording && !restart_pending) {
+        return;
+    }
+    if (recording && snapshot_count &&
+        head - snapshots[(snapshot_count - 1) % IRQLOG_SNAPSHOTS].pos < IRQLOG_WORDS / IRQLOG_SNAPSHOTS) {
+        return;
+    }
+
+    uint32_t ints = save_and_disable_interrupts();
+    if (scan_idle && deferred_idle()) {
+        if (restart_pending) {
+            start_us = time_us_64();
+            log_clock = start_us;
+            restart_pending = false;
+            recording = true;
+        }
+        // La próxima alarma abre una racha nueva, que empieza justo después de la instantánea
+        run_open = false;
+        snapshots[snapshot_count++ % IRQLOG_SNAPSHOTS] = (IrqLogSnapshot){
+            .pos = head,
+            .clock = log_clock,
+            .last_key_us = last_key_time,
+            .row = current_row,
+        };
+    }
+    restore_interrupts(ints);
+}
+
+void irqlog_restart() {
+    uint32_t ints = save_and_disable_interrupts();
+    recording = false;
+    restart_pending = true;
+    head = 0;
+    snapshot_count = 0;
+    from_boot = false;
+    flags = 0;
+    start_us = time_us_64();
+    log_clock = start_us;
+    restore_interrupts(ints);
+}
+
+void irqlog_export_text() {
+    uint32_t ints = save_and_disable_interrupts();
+    uint32_t n = head;
+    IrqLogSnapshot start;
+    uint8_t start_flags;
+    bool replayable = export_start(n, &start, &start_flags);
+    uint64_t clock = log_clock;
+    restore_interrupts(ints);
+
+    printf("\n# irqlog words=%lu/%u written=%lu recording=%d restart_pending=%d flags=%u snapshots=%lu "
+           "span_ms=%lu replay_words=%lu replay_ms=%lu\n",
+           (unsigned long)(n < IRQLOG_WORDS ? n : IRQLOG_WORDS), IRQLOG_WORDS, (unsigned long)n, recording,
+           restart_pending, flags, (unsigned long)snapshot_count, (unsigned long)((clock - start_us) / 1000),
+           (unsigned long)(replayable ? n - start.pos : 0),
+           (unsigned long)(replayable ? (clock - start.clock) / 1000 : 0));
+}
+
+static uint32_t fnv1a(uint32_t hash, const void* data, size_t len) {
+    const uint8_t* bytes = (const uint8_t*)data;
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+void irqlog_export_binary() {
+    // Solo la última palabra (una racha abierta) puede cambiar después de escrita: se copia
+    uint32_t ints = save_and_disable_interrupts();
+    uint32_t n = head;
+    uint32_t last = n ? words[(n - 1) & WORD_MASK] : 0;
+    IrqLogSnapshot start = {.pos = n, .clock = log_clock, .last_key_us = last_key_time, .row = current_row};
+    uint8_t start_flags = IRQLOG_FLAG_SNAPSHOT;
+    export_start(n, &start, &start_flags);
+    restore_interrupts(ints);
+
+    IrqLogHeader header = {
+        .magic = {'I', 'R'},
+        .version = IRQLOG_FORMAT_VERSION,
+        .flags = start_flags,
+        .period_us = KEYPAD_SCAN_PERIOD_MS * 1000u,
+        .count = n - start.pos,
+        .row = start.row,
+        .reserved = {0},
+        .start_us = start.clock,
+        .last_key_us = start.last_key_us,
+    };
+    uint32_t hash = fnv1a(2166136261u, &header, sizeof(header));
+    usb_cmd_write_binary(&header, sizeof(header));
+
+    // El margen de `export_start()` evita que las palabras se sobrescriban antes de enviarse
+    uint32_t chunk[EXPORT_CHUNK_WORDS];
+    uint32_t pos = start.pos;
+    while (pos != n) {
+        size_t k = 0;
+        for (; k < EXPORT_CHUNK_WORDS && pos != n; k++, pos++) {
+            chunk[k] = pos == n - 1 ? last : words[pos & WORD_MASK];
+        }
+        hash = fnv1a(hash, chunk, k * sizeof(uint32_t));
+        usb_cmd_write_binary(chunk, k * sizeof(uint32_t));
+    }
+    usb_cmd_write_binary(&hash, sizeof(hash));
+}
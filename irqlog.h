@@ -0,0 +1,151 @@
+/**
+ * @file irqlog.h
+ * @brief Registro binario compacto de las interrupciones del teclado y del escaneo de filas.
+ * 
+ * Desde el arranque se guarda cada flanco de columna (pin y fila escaneada en ese momento) y cada
+ * disparo de la alarma de escaneo (niveles de las columnas y fila antes de avanzar), con marcas de
+ * tiempo relativas. Los disparos en reposo (todas las columnas en alto) se agrupan en rachas a
+ * período nominal. El registro se exporta por USB y `tools/irq_replay.c` lo reproduce sobre una
+ * compilación de `tcl.c` para el anfitrión con reloj virtual.
+ * 
+ * El registro es circular: al llenarse sobrescribe las palabras más antiguas. Para que lo retenido
+ * siga siendo reproducible, en los momentos de reposo (sin sesión, sin teclas pendientes y con las
+ * columnas en alto) se toman instantáneas del estado que la reproducción necesita; si el comienzo
+ * ya se sobrescribió, la exportación empieza en la instantánea retenida más antigua.
+ * 
+ * Las definiciones de formato no dependen del SDK para que el reproductor las comparta.
+ * 
+ * Palabra de 32 bits: tipo (bits 31-30), dato (bits 29-22), delta en µs desde el evento anterior
+ * (bits 21-0).
+ */
+#ifndef IRQLOG_H
+#define IRQLOG_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Capacidad del registro en palabras (16 KB); debe ser potencia de 2.
+ */
+#define IRQLOG_WORDS 4096
+
+/**
+ * @brief Instantáneas de reposo retenidas; se toma una cada `IRQLOG_WORDS / IRQLOG_SNAPSHOTS`
+ * palabras como mínimo, para que cubran todo el registro.
+ */
+#define IRQLOG_SNAPSHOTS 8
+
+/**
+ * @brief Palabras que deben quedar por delante de la escritura al elegir el inicio de una exportación,
+ * para que no se sobrescriban mientras se envían (unos 0,3 s de actividad continua del teclado).
+ */
+#define IRQLOG_EXPORT_MARGIN 64
+
+/**
+ * @brief Versión del formato exportado.
+ */
+#define IRQLOG_FORMAT_VERSION 2
+
+/**
+ * @brief Bits del campo delta y su valor máximo (unos 4,2 s).
+ */
+#define IRQLOG_DELTA_BITS 22
+#define IRQLOG_DELTA_MAX ((1u << IRQLOG_DELTA_BITS) - 1)
+
+/**
+ * @brief Niveles de columna en reposo (las 4 en alto).
+ */
+#define IRQLOG_COLS_IDLE 0x0F
+
+/**
+ * @brief Indicador de cabecera: el registro empezó tras un reinicio del watchdog con sesión restaurada.
+ */
+#define IRQLOG_FLAG_RESUMED 0x01
+
+/**
+ * @brief Indicador de cabecera: el registro empieza en una instantánea de reposo (`row` y
+ * `last_key_us` dan el estado del escaneo en ese punto).
+ */
+#define IRQLOG_FLAG_SNAPSHOT 0x02
+
+/**
+ * @brief Tipos de evento.
+ */
+typedef enum {
+    IRQLOG_KEY_EDGE,   /**< Flanco de columna; dato = pin (bits 0-4) | fila (bits 5-6) */
+    IRQLOG_ALARM,      /**< Disparo con alguna columna en bajo; dato = niveles (bits 0-3) | fila (bits 4-5) */
+    IRQLOG_ALARM_RUN,  /**< Racha de disparos en reposo; dato = cantidad, delta hasta el primero, los demás a período nominal */
+    IRQLOG_TIME        /**< Solo avanza el reloj en delta (huecos mayores que `IRQLOG_DELTA_MAX`) */
+} IrqLogType;
+
+#define IRQLOG_WORD(type, data, delta) \
+    (((uint32_t)(type) << 30) | ((uint32_t)(data) << IRQLOG_DELTA_BITS) | (uint32_t)(delta))
+#define IRQLOG_TYPE(w) ((IrqLogType)((w) >> 30))
+#define IRQLOG_DATA(w) (((w) >> IRQLOG_DELTA_BITS) & 0xFF)
+#define IRQLOG_DELTA(w) ((w) & IRQLOG_DELTA_MAX)
+
+/**
+ * @brief Cabecera del registro exportado (little-endian, 32 bytes), seguida de `count` palabras
+ * y de la suma FNV-1a de 32 bits de cabecera y palabras.
+ */
+typedef struct {
+    char magic[2];        /**< "IR" */
+    uint8_t version;      /**< `IRQLOG_FORMAT_VERSION` */
+    uint8_t flags;        /**< `IRQLOG_FLAG_*` */
+    uint32_t period_us;   /**< Período nominal del escaneo */
+    uint32_t count;       /**< Palabras exportadas */
+    uint8_t row;          /**< Fila escaneada al inicio */
+    uint8_t reserved[3];  /**< Cero */
+    uint64_t start_us;    /**< Instante del inicio, desde el arranque */
+    uint64_t last_key_us; /**< Última tecla aceptada al inicio (antirrebote) */
+} IrqLogHeader;
+
+/**
+ * @brief Empieza a grabar; debe llamarse justo antes de `init_keypad()`, para no perder el primer disparo.
+ * 
+ * @param resumed true si el arranque restauró una sesión (la reproducción parte de otro estado).
+ */
+void irqlog_init(bool resumed);
+
+/**
+ * @brief Registra un flanco de columna (desde `gpio_callback()`).
+ * 
+ * @param gpio Pin de la columna.
+ * @param row Fila escaneada en el momento del flanco.
+ */
+void irqlog_key_edge(uint32_t gpio, uint8_t row);
+
+/**
+ * @brief Registra un disparo de la alarma de escaneo (desde `timer_callback()`).
+ * 
+ * @param col_levels Niveles de las columnas en el orden de `COL_PINS` (bit en 1 = alto).
+ * @param row Fila escaneada antes del disparo.
+ */
+void irqlog_alarm(uint8_t col_levels, uint8_t row);
+
+/**
+ * @brief Toma una instantánea si toca; el bucle principal la llama cuando no hay sesión abierta.
+ * 
+ * Solo la toma si no hay trabajo diferido pendiente y el último escaneo vio las columnas en
+ * alto, y como mucho una vez cada `IRQLOG_WORDS / IRQLOG_SNAPSHOTS` palabras. Tras
+ * `irqlog_restart()`, la primera instantánea reanuda la grabación.
+ */
+void irqlog_idle(void);
+
+/**
+ * @brief Descarta lo grabado y vuelve a grabar desde el próximo reposo.
+ */
+void irqlog_restart(void);
+
+/**
+ * @brief Muestra por USB el estado de la grabación.
+ */
+void irqlog_export_text(void);
+
+/**
+ * @brief Exporta por USB, en formato binario, lo retenido desde su primer punto reproducible; la
+ * grabación continúa.
+ */
+void irqlog_export_binary(void);
+
+#endif // IRQLOG_H
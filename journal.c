@@ -0,0 +1,389 @@
+/**
+ * @file journal.c
+ * @brief Escritura por páginas del diario en una región circular de flash y exportación incremental.
+ * 
+ * Al arrancar se recorren los pies de página: la página válida con mayor secuencia marca el final
+ * del diario y la siguiente es la posición de escritura. Una página se programa una sola vez; antes
+ * de entrar a un sector se comprueba que esté borrado y, si no lo está, se borra (por adelantado en
+ * `journal_poll()` si el terminal está libre, o en línea como último recurso).
+ */
+#include "journal.h"
+#include <stdio.h>
+#include <string.h>
+#include "hardware/flash.h"
+#include "hardware/sync.h"
+#include "hardware/watchdog.h"
+#include "usb_cmd.h"
+
+#define JOURNAL_PAGES (FLASH_JOURNAL_SIZE / FLASH_PAGE_SIZE)
+#define JOURNAL_SECTORS (FLASH_JOURNAL_SIZE / FLASH_SECTOR_SIZE)
+#define PAGES_PER_SECTOR (FLASH_SECTOR_SIZE / FLASH_PAGE_SIZE)
+
+/**
+ * @brief Marca de la página pendiente en RAM no inicializada.
+ */
+#define PENDING_MAGIC 0x4A50454Eu
+
+/**
+ * @brief Página en construcción con su marca y suma de verificación.
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t check;
+    JournalPage page;
+} PendingPage;
+
+/**
+ * @brief Publica el desplazamiento del diario como símbolo absoluto del enlazador.
+ * 
+ * `flash_layout.ld` lo usa para comprobar al enlazar que la imagen del programa termina antes
+ * del diario; así la comprobación toma el valor de `flash_layout.h` y no una copia.
+ */
+static void __attribute__((used)) export_layout_symbol(void) {
+    __asm__(".global __flash_journal_offset\n"
+            ".set __flash_journal_offset, %c0" : : "i"(FLASH_JOURNAL_OFFSET));
+}
+
+/**
+ * @brief Página pendiente; sobrevive a un reinicio del watchdog.
+ */
+static PendingPage __uninitialized_ram(pending);
+
+static absolute_time_t pending_since;
+static uint32_t head = 0;            /**< Próxima página a programar */
+static uint32_t next_seq = 1;
+static uint32_t exported_seq = 0;    /**< Hasta aquí, todo lo retenido salió en alguna exportación */
+static int ready_sector = -1;        /**< Sector comprobado borrado por adelantado */
+
+/**
+ * @brief Estadísticas de escritura desde el arranque.
+ */
+static struct {
+    uint32_t pages;
+    uint32_t erases;
+    uint32_t inline_erases;          /**< Borrados que no pudieron hacerse por adelantado */
+    uint32_t program_max_us;
+    uint32_t erase_max_us;
+} stats;
+
+/**
+ * @brief Exportación en curso.
+ */
+static struct {
+    bool active;
+    uint32_t page;                   /**< Próxima página a examinar */
+    uint32_t left;                   /**< Páginas que faltan examinar */
+    uint32_t from;
+    uint32_t to;
+    uint32_t count;
+    uint32_t hash;
+    uint32_t last_seq;               /**< Última secuencia existente al iniciar */
+} export;
+
+static const JournalPage* page_at(uint32_t index) {
+    return (const JournalPage*)(XIP_BASE + FLASH_JOURNAL_OFFSET + index * FLASH_PAGE_SIZE);
+}
+
+static uint32_t fnv1a(uint32_t hash, const void* data, size_t len) {
+    const uint8_t* bytes = (const uint8_t*)data;
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+static uint32_t page_check(const JournalPage* page) {
+    uint32_t hash = fnv1a(2166136261u, page->records, page->count * sizeof(JournalRecord));
+    return fnv1a(hash, &page->magic, 3 * sizeof(uint32_t));
+}
+
+static bool page_valid(const JournalPage* page) {
+    return page->magic == JOURNAL_MAGIC && page->count > 0 &&
+           page->count <= JOURNAL_RECORDS_PER_PAGE && page->check == page_check(page);
+}
+
+static bool range_erased(const void* data, size_t len) {
+    const uint32_t* words = (const uint32_t*)data;
+    for (size_t i = 0; i < len / sizeof(uint32_t); i++) {
+        if (words[i] != 0xFFFFFFFFu) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Deja la página pendiente vacía y su suma al día.
+ */
+static void pending_clear(void) {
+    memset(&pending.page, 0xFF, sizeof(pending.page));
+    pending.page.count = 0;
+    pending.magic = PENDING_MAGIC;
+    pending.check = page_check(&pending.page);
+}
+
+static void erase_sector(uint32_t sector) {
+    uint64_t start = time_us_64();
+    uint32_t ints = save_and_disable_interrupts();
+    flash_range_erase(FLASH_JOURNAL_OFFSET + sector * FLASH_SECTOR_SIZE, FLASH_SECTOR_SIZE);
+    restore_interrupts(ints);
+    uint32_t elapsed = (uint32_t)(time_us_64() - start);
+    stats.erases++;
+    if (elapsed > stats.erase_max_us) {
+        stats.erase_max_us = elapsed;
+    }
+}
+
+/**
+ * @brief Programa la página pendiente en `head`.
+ */
+static void flush_page(void) {
+    if (pending.page.count == 0) {
+        return;
+    }
+    while (!range_erased(page_at(head), FLASH_PAGE_SIZE)) {
+        if (head % PAGES_PER_SECTOR == 0) {
+            erase_sector(head / PAGES_PER_SECTOR);
+            stats.inline_erases++;
+        } else {
+            head = (head + 1) % JOURNAL_PAGES;     // página dañada por un corte: se salta
+        }
+    }
+
+    pending.page.magic = JOURNAL_MAGIC;
+    pending.page.check = page_check(&pending.page);
+
+    uint64_t start = time_us_64();
+    uint32_t ints = save_and_disable_interrupts();
+    flash_range_program(FLASH_JOURNAL_OFFSET + head * FLASH_PAGE_SIZE,
+                        (const uint8_t*)&pending.page, FLASH_PAGE_SIZE);
+    restore_interrupts(ints);
+    uint32_t elapsed = (uint32_t)(time_us_64() - start);
+    stats.pages++;
+    if (elapsed > stats.program_max_us) {
+        stats.program_max_us = elapsed;
+    }
+
+    if (ready_sector == (int)(head / PAGES_PER_SECTOR)) {
+        ready_sector = -1;                          // el sector preparado ya tiene datos
+    }
+    head = (head + 1) % JOURNAL_PAGES;
+    pending_clear();
+}
+
+/**
+ * @brief Deja borrado el sector que se usará a continuación.
+ */
+static void prepare_ahead(void) {
+    uint32_t sector = head / PAGES_PER_SECTOR;
+    if (head % PAGES_PER_SECTOR != 0) {
+        sector = (sector + 1) % JOURNAL_SECTORS;
+    }
+    if ((int)sector == ready_sector) {
+        return;
+    }
+    const void* base = (const void*)(XIP_BASE + FLASH_JOURNAL_OFFSET + sector * FLASH_SECTOR_SIZE);
+    if (!range_erased(base, FLASH_SECTOR_SIZE)) {
+        erase_sector(sector);
+    }
+    ready_sector = (int)sector;
+}
+
+void journal_init() {
+    const JournalPage* last = NULL;
+    uint32_t last_index = 0;
+    for (uint32_t i = 0; i < JOURNAL_PAGES; i++) {
+        const JournalPage* page = page_at(i);
+        if (page_valid(page) && (last == NULL || page->first_seq > last->first_seq)) {
+            last = page;
+            last_index = i;
+        }
+    }
+    if (last != NULL) {
+        head = (last_index + 1) % JOURNAL_PAGES;
+        next_seq = last->first_seq + last->count;
+    }
+
+    // La página pendiente solo es confiable tras un reinicio del watchdog y si no llegó a programarse
+    bool watchdog_reboot = watchdog_caused_reboot();
+    bool resume = watchdog_reboot && pending.magic == PENDING_MAGIC &&
+                  pending.page.count > 0 && pending.page.count <= JOURNAL_RECORDS_PER_PAGE &&
+                  pending.check == page_check(&pending.page) && pending.page.first_seq >= next_seq;
+    if (resume) {
+        next_seq = pending.page.first_seq + pending.page.count;
+        pending_since = get_absolute_time();
+    } else {
+        pending_clear();
+    }
+
+    journal_log(JOURNAL_BOOT, 0, 0, watchdog_reboot);
+}
+
+void journal_log(JournalEvent event, uint32_t account, uint8_t detail, int32_t value) {
+    if (pending.page.count == JOURNAL_RECORDS_PER_PAGE) {
+        flush_page();                               // el bucle principal no alcanzó a vaciarla
+    }
+    if (pending.page.count == 0) {
+        pending.page.first_seq = next_seq;
+        pending_since = get_absolute_time();
+    }
+    JournalRecord* rec = &pending.page.records[pending.page.count++];
+    rec->seq = next_seq++;
+    rec->time_ms = to_ms_since_boot(get_absolute_time());
+    rec->info = JOURNAL_INFO(account, event, detail);
+    rec->value = value;
+    pending.check = page_check(&pending.page);
+}
+
+void journal_flush() {
+    flush_page();
+}
+
+/**
+ * @brief Envía una trama de exportación sin pasar por la traducción de fin de línea de stdio.
+ */
+static void export_frame(const void* data, size_t len) {
+    JournalFrame frame = {
+        .magic = {'J', 'F'},
+        .len = (uint16_t)len,
+    };
+    frame.check = fnv1a(fnv1a(2166136261u, &frame.len, sizeof(frame.len)), data, len);
+    usb_cmd_write_binary(&frame, sizeof(frame));
+    usb_cmd_write_binary(data, len);
+}
+
+/**
+ * @brief Envía los registros en rango de unas pocas páginas, una trama por página; al terminar, el cierre.
+ */
+static void export_step(void) {
+    for (int n = 0; n < JOURNAL_EXPORT_PAGES_PER_POLL && export.left; n++) {
+        const JournalPage* page = page_at(export.page);
+        if (page_valid(page)) {
+            JournalRecord chunk[JOURNAL_RECORDS_PER_PAGE];
+            uint32_t k = 0;
+            for (uint32_t i = 0; i < page->count; i++) {
+                const JournalRecord* rec = &page->records[i];
+                if (rec->seq >= export.from && rec->seq <= export.to) {
+                    chunk[k++] = *rec;
+                }
+            }
+            if (k) {
+                export_frame(chunk, k * sizeof(JournalRecord));
+                export.hash = fnv1a(export.hash, chunk, k * sizeof(JournalRecord));
+                export.count += k;
+            }
+        }
+        export.page = (export.page + 1) % JOURNAL_PAGES;
+        export.left--;
+    }
+    if (export.left == 0) {
+        struct {
+            JournalRecord end;
+            uint32_t hash;
+        } tail = {{JOURNAL_SEQ_END, to_ms_since_boot(get_absolute_time()), 0, (int32_t)export.count},
+                   export.hash};
+        export_frame(&tail, sizeof(tail));
+        if (export.from <= exported_seq + 1 && export.to > exported_seq) {
+            exported_seq = export.to < export.last_seq ? export.to : export.last_seq;
+        }
+        export.active = false;
+    }
+}
+
+void journal_poll(bool idle) {
+    if (pending.page.count == JOURNAL_RECORDS_PER_PAGE ||
+        (pending.page.count > 0 && absolute_time_diff_us(pending_since, get_absolute_time()) >=
+                                       (int64_t)JOURNAL_FLUSH_MS * 1000)) {
+        flush_page();
+    }
+    if (idle && !export.active) {
+        prepare_ahead();                            // no se borra lo que la exportación aún no leyó
+    }
+    if (export.active) {
+        export_step();
+    }
+}
+
+void journal_export_start(uint32_t from, uint32_t to) {
+    flush_page();
+
+    JournalExportHeader header = {
+        .magic = {'J', 'R'},
+        .version = JOURNAL_FORMAT_VERSION,
+        .record_size = sizeof(JournalRecord),
+        .from_seq = from,
+        .to_seq = to,
+    };
+    export_frame(&header, sizeof(header));
+
+    export.active = true;
+    export.page = head;                              // la posición de escritura precede a la página más antigua
+    export.left = JOURNAL_PAGES;
+    export.from = from;
+    export.to = to;
+    export.count = 0;
+    export.hash = 2166136261u;
+    export.last_seq = next_seq - 1;
+}
+
+void journal_export_text() {
+    printf("\n# journal seq=%lu exported=%lu head=%lu pending=%lu pages=%lu erases=%lu inline_erases=%lu "
+           "program_max_us=%lu erase_max_us=%lu exporting=%d\n",
+           (unsigned long)(next_seq - 1), (unsigned long)exported_seq, (unsigned long)head,
+           (unsigned long)pending.page.count,
+           (unsigned long)stats.pages, (unsigned long)stats.erases, (unsigned long)stats.inline_erases,
+           (unsigned long)stats.program_max_us, (unsigned long)stats.erase_max_us, export.active);
+}
+
+/**
+ * @brief Indica si programar `pages` páginas desde `head`, con el borrado de sus sectores y del
+ * siguiente, alcanzaría registros que ninguna exportación completa incluyó.
+ */
+static bool overwrites_unexported(uint32_t pages) {
+    uint32_t end = ((head + pages - 1) / PAGES_PER_SECTOR + 2) * PAGES_PER_SECTOR;
+    for (uint32_t i = head; i < end && i - head < JOURNAL_PAGES; i++) {
+        const JournalPage* page = page_at(i % JOURNAL_PAGES);
+        if (page_valid(page) && page->first_seq + page->count - 1 > exported_seq) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void journal_bench(uint32_t count) {
+    if (count == 0 || count > JOURNAL_BENCH_MAX) {
+        printf("\nuso: journal bench 1..%u\n", JOURNAL_BENCH_MAX);
+        return;
+    }
+    flush_page();
+    uint32_t needed = (count + JOURNAL_RECORDS_PER_PAGE - 1) / JOURNAL_RECORDS_PER_PAGE;
+    if (export.active || overwrites_unexported(needed)) {
+        printf("\nbench rechazado: %s\n", export.active ? "exportación en curso"
+                                                       : "sobrescribiría registros sin exportar (journal export)");
+        return;
+    }
+    uint32_t pages = stats.pages;
+    uint32_t erases = stats.erases;
+    uint64_t start = time_us_64();
+
+    for (uint32_t i = 0; i < count; i++) {
+        journal_log(JOURNAL_BENCH, 0, 0, (int32_t)i);
+        if (pending.page.count == JOURNAL_RECORDS_PER_PAGE) {
+            flush_page();
+            watchdog_update();
+        }
+    }
+    flush_page();
+
+    uint64_t elapsed = time_us_64() - start;
+    if (elapsed == 0) {
+        elapsed = 1;
+    }
+    printf("\nbench records=%lu ms=%lu records_s=%lu bytes_s=%lu pages=%lu erases=%lu "
+           "program_max_us=%lu erase_max_us=%lu\n",
+           (unsigned long)count, (unsigned long)(elapsed / 1000),
+           (unsigned long)(count * 1000000ull / elapsed),
+           (unsigned long)(count * sizeof(JournalRecord) * 1000000ull / elapsed),
+           (unsigned long)(stats.pages - pages), (unsigned long)(stats.erases - erases),
+           (unsigned long)stats.program_max_us, (unsigned long)stats.erase_max_us);
+}
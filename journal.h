@@ -0,0 +1,182 @@
+/**
+ * @file journal.h
+ * @brief Diario binario de solo agregado con los eventos de sesión, para conciliación.
+ * 
+ * Cada evento (inicio de sesión, fallo, bloqueo, ID inexistente, retiro, consulta de saldo, cambio
+ * de clave) se guarda como un registro de 16 bytes con número de secuencia. Los registros se
+ * acumulan en RAM y se programan de a una página de flash (15 registros y un pie con suma de
+ * verificación) desde el bucle principal, al llenarse la página o al pasar `JOURNAL_FLUSH_MS` desde
+ * el primer registro pendiente. La región es circular; el sector siguiente se borra por adelantado
+ * solo con el terminal en reposo (sin sesión ni ID a medio ingresar), y al dar la vuelta se pierden los registros más antiguos.
+ * 
+ * La página pendiente vive en RAM no inicializada y se recupera tras un reinicio del watchdog.
+ * 
+ * Exportación: `journal export [desde [hasta]]` envía, de a pocas páginas por iteración del bucle,
+ * la cabecera "JR", los registros con secuencia en el rango, un registro terminador (secuencia
+ * `JOURNAL_SEQ_END`, valor = cantidad) y la suma FNV-1a de 32 bits de los registros. Como la sesión
+ * sigue escribiendo texto por el mismo puerto mientras dura la exportación, ese flujo viaja en
+ * tramas "JF" con longitud y suma propia; el decodificador descarta lo que queda entre tramas.
+ */
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include "pico/stdlib.h"
+#include "flash_layout.h"
+
+/**
+ * @brief Versión del formato de exportación.
+ */
+#define JOURNAL_FORMAT_VERSION 2
+
+/**
+ * @brief Marca del pie de una página válida.
+ */
+#define JOURNAL_MAGIC 0x4A524E4Cu
+
+/**
+ * @brief Registros por página de flash (el resto es el pie).
+ */
+#define JOURNAL_RECORDS_PER_PAGE 15
+
+/**
+ * @brief Antigüedad máxima de un registro en RAM antes de programarlo, en milisegundos.
+ */
+#define JOURNAL_FLUSH_MS 10000
+
+/**
+ * @brief Páginas examinadas por iteración del bucle durante una exportación.
+ */
+#define JOURNAL_EXPORT_PAGES_PER_POLL 4
+
+/**
+ * @brief Bytes máximos del contenido de una trama de exportación (los registros de una página).
+ */
+#define JOURNAL_FRAME_MAX (JOURNAL_RECORDS_PER_PAGE * sizeof(JournalRecord))
+
+/**
+ * @brief Registros máximos de una prueba de rendimiento.
+ */
+#define JOURNAL_BENCH_MAX 4096
+
+/**
+ * @brief Secuencia del registro terminador de una exportación.
+ */
+#define JOURNAL_SEQ_END 0xFFFFFFFFu
+
+/**
+ * @brief Tipos de evento.
+ */
+typedef enum {
+    JOURNAL_BOOT,             /**< Arranque; valor = 1 si fue un reinicio del watchdog */
+    JOURNAL_LOGIN,            /**< Inicio de sesión */
+    JOURNAL_LOGIN_FAILED,     /**< Clave incorrecta; detalle = intentos fallidos */
+    JOURNAL_LOCKOUT,          /**< Cuenta bloqueada por intentos */
+    JOURNAL_UNKNOWN_ID,       /**< ID inexistente o bloqueado; cuenta = dígitos ingresados */
+    JOURNAL_DISPENSE,         /**< Retiro confirmado; detalle = denominación, valor = monto */
+    JOURNAL_BALANCE,          /**< Consulta de saldo; valor = saldo */
+    JOURNAL_PASSWORD_CHANGE,  /**< Cambio de clave */
+    JOURNAL_BENCH,            /**< Registro sintético de `journal bench` */
+    JOURNAL_DISPENSE_RECOVERED,  /**< Retiro confirmado por `txn_recover()` tras un reinicio; como `JOURNAL_DISPENSE` */
+    JOURNAL_EVENT_COUNT
+} JournalEvent;
+
+/**
+ * @brief Registro del diario (16 bytes).
+ * 
+ * `info` empaqueta la cuenta (bits 0-19), el evento (bits 20-23) y el detalle (bits 24-31).
+ */
+typedef struct {
+    uint32_t seq;         /**< Número de secuencia, creciente desde 1 */
+    uint32_t time_ms;     /**< Milisegundos desde el arranque */
+    uint32_t info;        /**< Cuenta, evento y detalle */
+    int32_t value;        /**< Monto, saldo o dato del evento */
+} JournalRecord;
+
+#define JOURNAL_INFO(account, event, detail) \
+    (((uint32_t)(account) & 0xFFFFFu) | ((uint32_t)(event) << 20) | ((uint32_t)(detail) << 24))
+#define JOURNAL_ACCOUNT(info) ((info) & 0xFFFFFu)
+#define JOURNAL_EVENT(info) (((info) >> 20) & 0x0Fu)
+#define JOURNAL_DETAIL(info) ((info) >> 24)
+
+/**
+ * @brief Página de flash del diario (256 bytes).
+ */
+typedef struct {
+    JournalRecord records[JOURNAL_RECORDS_PER_PAGE];
+    uint32_t magic;       /**< `JOURNAL_MAGIC` */
+    uint32_t first_seq;   /**< Secuencia del primer registro */
+    uint32_t count;       /**< Registros válidos */
+    uint32_t check;       /**< FNV-1a de los registros válidos y de los tres campos anteriores */
+} JournalPage;
+
+/**
+ * @brief Cabecera de una exportación (12 bytes).
+ */
+typedef struct {
+    char magic[2];        /**< "JR" */
+    uint8_t version;      /**< `JOURNAL_FORMAT_VERSION` */
+    uint8_t record_size;  /**< `sizeof(JournalRecord)` */
+    uint32_t from_seq;    /**< Primera secuencia pedida */
+    uint32_t to_seq;      /**< Última secuencia pedida */
+} JournalExportHeader;
+
+/**
+ * @brief Cabecera de una trama de exportación (8 bytes), seguida de `len` bytes de contenido.
+ */
+typedef struct {
+    char magic[2];        /**< "JF" */
+    uint16_t len;         /**< Bytes de contenido, hasta `JOURNAL_FRAME_MAX` */
+    uint32_t check;       /**< FNV-1a de `len` y del contenido */
+} JournalFrame;
+
+/**
+ * @brief Ubica la posición de escritura, recupera la página pendiente (si el arranque lo provocó el
+ * watchdog) y registra el arranque.
+ */
+void journal_init(void);
+
+/**
+ * @brief Agrega un evento a la página en RAM (no programa flash salvo que la página siga llena).
+ * 
+ * @param event Tipo de evento.
+ * @param account ID numérico de la cuenta (0 si no aplica).
+ * @param detail Detalle de 8 bits.
+ * @param value Monto, saldo o dato del evento.
+ */
+void journal_log(JournalEvent event, uint32_t account, uint8_t detail, int32_t value);
+
+/**
+ * @brief Programa la página pendiente, borra por adelantado y avanza la exportación en curso.
+ * 
+ * @param idle true si el terminal está en reposo, `session_idle()` (se permite borrar un sector por
+ *             adelantado).
+ */
+void journal_poll(bool idle);
+
+/**
+ * @brief Programa ya la página pendiente, si tiene registros.
+ */
+void journal_flush(void);
+
+/**
+ * @brief Inicia una exportación incremental de los registros con secuencia en `[from, to]`.
+ * 
+ * Al terminar, si cubrió todo lo anterior a lo ya exportado, los registros existentes al inicio
+ * cuentan como exportados para `journal_bench()`.
+ */
+void journal_export_start(uint32_t from, uint32_t to);
+
+/**
+ * @brief Muestra por USB la posición, la secuencia y las estadísticas de escritura.
+ */
+void journal_export_text(void);
+
+/**
+ * @brief Prueba de rendimiento: escribe `count` registros `JOURNAL_BENCH` e informa el caudal.
+ * 
+ * Se rechaza durante una exportación y si las páginas que ocuparía (más el sector que se borra por
+ * adelantado) contienen registros que ninguna exportación completa incluyó.
+ */
+void journal_bench(uint32_t count);
+
+#endif // JOURNAL_H
@@ -0,0 +1,57 @@
+/**
+ * @file keybuf.c
+ * @brief Cola circular sin bloqueos de teclas anticipadas.
+ * 
+ * `head` solo lo escribe el productor y `tail` solo el consumidor; los índices crecen sin límite
+ * y se reducen con la máscara al acceder, así la cola llena y la vacía se distinguen sin ranura libre.
+ * Productor y consumidor corren en el bucle principal, por lo que `flushed_at` no necesita
+ * protección.
+ */
+#include "keybuf.h"
+
+static KeyEvent events[KEYBUF_SIZE];
+static volatile uint32_t head = 0;
+static volatile uint32_t tail = 0;
+static volatile uint32_t dropped = 0;
+
+/**
+ * @brief Instante del último vaciado; las teclas pulsadas antes ya no se aceptan.
+ */
+static absolute_time_t flushed_at;
+
+bool keybuf_push(char key, absolute_time_t pressed_at) {
+    if (absolute_time_diff_us(flushed_at, pressed_at) < 0) {
+        return false;            // pulsada antes del vaciado, aún pendiente en la cola diferida
+    }
+    uint32_t h = head;
+    if (h - tail >= KEYBUF_SIZE) {
+        dropped++;
+        return false;
+    }
+    events[h & (KEYBUF_SIZE - 1)].key = key;
+    events[h & (KEYBUF_SIZE - 1)].pressed_at = pressed_at;
+    __compiler_memory_barrier();
+    head = h + 1;
+    return true;
+}
+
+bool keybuf_pop(KeyEvent* ev) {
+    uint32_t t = tail;
+    if (t == head) {
+        return false;
+    }
+    __compiler_memory_barrier();
+    *ev = events[t & (KEYBUF_SIZE - 1)];
+    __compiler_memory_barrier();
+    tail = t + 1;
+    return true;
+}
+
+void keybuf_flush() {
+    flushed_at = get_absolute_time();
+    tail = head;
+}
+
+uint32_t keybuf_dropped() {
+    return dropped;
+}
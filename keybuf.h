@@ -0,0 +1,58 @@
+/**
+ * @file keybuf.h
+ * @brief Búfer de teclas anticipadas entre la interrupción del teclado y el bucle principal.
+ * 
+ * Cola circular de un productor (el trabajo diferido que decodifica las teclas) y un consumidor
+ * (el bucle principal) sin bloqueos. Las teclas pulsadas mientras el sistema está ocupado (LEDs
+ * de 2 y 5 segundos, motor) quedan en cola y se procesan en orden al terminar; la cola se vacía
+ * ante un error o al cerrar la sesión.
+ */
+#ifndef KEYBUF_H
+#define KEYBUF_H
+
+#include "pico/stdlib.h"
+
+/**
+ * @brief Capacidad de la cola; debe ser potencia de 2.
+ */
+#define KEYBUF_SIZE 16
+
+/**
+ * @brief Tecla en cola con el instante en que se pulsó.
+ */
+typedef struct {
+    char key;                     /**< Tecla decodificada */
+    absolute_time_t pressed_at;   /**< Instante de la pulsación */
+} KeyEvent;
+
+/**
+ * @brief Encola una tecla (solo desde el trabajo diferido del teclado).
+ * 
+ * Descarta las teclas pulsadas antes del último `keybuf_flush()`: durante una espera bloqueante
+ * sus flancos siguen en la cola diferida y se decodifican después del vaciado.
+ * 
+ * @param key Tecla decodificada.
+ * @param pressed_at Instante de la pulsación.
+ * @return false si la cola estaba llena o la tecla es anterior al último vaciado.
+ */
+bool keybuf_push(char key, absolute_time_t pressed_at);
+
+/**
+ * @brief Extrae la tecla más antigua.
+ * 
+ * @param ev Destino de la tecla.
+ * @return true si había una tecla en cola.
+ */
+bool keybuf_pop(KeyEvent* ev);
+
+/**
+ * @brief Descarta todas las teclas anticipadas, incluidas las pulsadas y aún sin decodificar.
+ */
+void keybuf_flush(void);
+
+/**
+ * @brief Número de teclas descartadas por cola llena desde el arranque.
+ */
+uint32_t keybuf_dropped(void);
+
+#endif // KEYBUF_H
@@ -12,8 +12,17 @@
  *          Yeiner Alexander Martinez Barrera
  * @date 07/10/2024
  */
+#include "main.h"
+#include "main_loop.h"
 #include "tcl.h"
 #include "s_luminosa.h"
+#include "recovery.h"
+#include "messages.h"
+#include "provision.h"
+#include "display.h"
+#include "irqlog.h"
+#include "journal.h"
+#include "memstat.h"
 
 /**
  * @brief Función principal del sistema.
@@ -21,34 +30,33 @@
  * Esta función inicializa el sistema, enciende un LED de forma permanente, inicia el teclado matricial y
  * espera la entrada del usuario. El sistema actualiza el estado del LED titilante y maneja el ingreso del ID
  * y la contraseña del usuario, verificando si se ha excedido el tiempo máximo permitido para la entrada.
+ * Tras un reinicio provocado por el watchdog reanuda la sesión guardada en lugar de reiniciar desde cero.
  * 
  * @return 0 si la ejecución es exitosa.
  */
 int main() {
-    printf("Sistema de Control de Acceso\n");
-    printf("Ingrese ID de 6 dígitos:\n");
+    memstat_init();             /**< Pinta las pilas antes de que crezcan */
     stdio_init_all();           /**< Inicializa el subsistema */
+    memstat_usb_init();         /**< Muestrea la pila en la interrupción USB que instaló `stdio_init_all()` */
     inicialization();           /**< Inicializa las señales luminosas */
-    led_on_gpio12_permanently();     /**< Enciende el LED amarillo antes de ser presionada alguna tecla */
+    display_init();             /**< Inicializa la pantalla antes del primer mensaje */
+    journal_init();                  /**< Ubica el final del diario antes de que la recuperación anote un retiro */
+    bool resumed = recovery_init();  /**< Activa el watchdog y restaura la sesión si hubo un reinicio */
+    provision_init();                /**< Selecciona la tabla de cuentas aprovisionadas en flash */
+    if (!resumed) {
+        msg_send(MSG_BOOT);
+        led_on_gpio12_permanently();     /**< Enciende el LED amarillo antes de ser presionada alguna tecla */
+    }
+    irqlog_init(resumed);            /**< Graba las interrupciones del teclado desde antes del primer escaneo */
     init_keypad();                   /**< Inicializa el teclado matricial y configura los pines GPIO correspondientes */
     last_key_time = get_absolute_time();  /**< Registra el tiempo de la última tecla presionada */
-    input_start_time = get_absolute_time();   /**< Registra el tiempo de inicio del input */
+    session_init();                  /**< Registra el flujo de sesión en el planificador */
     
 
     
     while (true) {
-        update_blink();   /**< Actualiza el estado del LED titilante (LED amarillo titila ingresando clave) */
-        if (key_pressed) {
-            process_key(last_key);   /**< Procesa la última tecla presionada */
-            key_pressed = false;     /**< Reinicia la bandera de tecla presionada */
-        }
-        
-    if (current_state == STATE_ENTER_PASSWORD &&
-        absolute_time_diff_us(input_start_time, get_absolute_time()) > (MAX_INPUT_TIME_MS * 1000)) {
-        handle_timeout(); /**< Maneja el tiempo límite */
-    }
-
-        sleep_ms(500);          /**< retraso de 500 ms  */
+        main_loop_step(NULL);            /**< Teclas, plazos, comandos USB, watchdog y diario */
+        sleep_ms(MAIN_LOOP_PERIOD_MS);   /**< retraso corto: las teclas esperan en la cola, no en el retardo */
     }
     return 0;
 }
@@ -10,4 +10,12 @@
 
 // Write your definitions and other macros here
 
+/**
+ * @brief Periodo del bucle principal en milisegundos.
+ * 
+ * Las teclas se acumulan en la cola de teclas anticipadas, por lo que el bucle solo necesita un
+ * retardo corto para no ocupar la CPU.
+ */
+#define MAIN_LOOP_PERIOD_MS 10
+
 #endif
\ No newline at end of file
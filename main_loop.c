@@ -0,0 +1,36 @@
+/**
+ * @file main_loop.c
+ * @brief Iteración del bucle principal.
+ */
+#include "main_loop.h"
+#include "tcl.h"
+#include "s_luminosa.h"
+#include "recovery.h"
+#include "usb_cmd.h"
+#include "flow.h"
+#include "deferred.h"
+#include "irqlog.h"
+#include "journal.h"
+
+bool main_loop_step(KeyEvent* processed) {
+    update_blink();   /**< Actualiza el estado del LED titilante (LED amarillo titila ingresando clave) */
+    deferred_run();   /**< Atiende el trabajo diferido de las interrupciones (decodificación de teclas) */
+    KeyEvent ev;
+    bool got_key = keybuf_pop(&ev);
+    if (got_key) {
+        process_key_event(&ev);   /**< Procesa la tecla más antigua de la cola (una por iteración) */
+        if (processed) {
+            *processed = ev;
+        }
+    } else {
+        flow_run(NULL);           /**< Sin teclas: los flujos vigilan sus plazos */
+        if (session_idle()) {
+            irqlog_idle();        /**< Punto de reposo: instantánea para reproducir el registro circular */
+        }
+    }
+
+    usb_cmd_poll();         /**< Atiende comandos de servicio por USB (métricas) */
+    recovery_poll();        /**< Alimenta el watchdog y guarda el punto de control */
+    journal_poll(session_idle());   /**< Programa el diario por páginas y avanza la exportación */
+    return got_key;
+}
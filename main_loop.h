@@ -0,0 +1,22 @@
+/**
+ * @file main_loop.h
+ * @brief Una iteración del bucle principal, compartida por `main.c` y el reproductor de interrupciones.
+ */
+#ifndef MAIN_LOOP_H
+#define MAIN_LOOP_H
+
+#include "pico/stdlib.h"
+#include "keybuf.h"
+
+/**
+ * @brief Ejecuta una iteración del bucle principal, sin el retardo entre iteraciones.
+ * 
+ * Atiende el trabajo diferido, procesa como mucho una tecla de la cola y, sin teclas, deja que los
+ * flujos venzan sus plazos; luego atiende los comandos USB, el watchdog y el diario.
+ * 
+ * @param processed Destino de la tecla procesada, o NULL.
+ * @return true si se procesó una tecla.
+ */
+bool main_loop_step(KeyEvent* processed);
+
+#endif // MAIN_LOOP_H
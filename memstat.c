@@ -0,0 +1,141 @@
+/**
+ * @file memstat.c
+ * @brief Pintado de pilas, muestreo en interrupciones e informe de memoria por USB.
+ * 
+ * Los límites de las regiones salen de los símbolos del guion de enlace del SDK: la pila del
+ * núcleo 0 ocupa SCRATCH_Y (reservados `__StackBottom`..`__StackTop`, y por debajo lo que deje libre
+ * `.scratch_y`), la del núcleo 1 SCRATCH_X, y el montículo crece desde el final de `.bss` hasta el
+ * final de la RAM principal.
+ */
+#include "memstat.h"
+#include <malloc.h>
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+#include "hardware/irq.h"
+#include "tcl.h"
+#include "keybuf.h"
+#include "transaction.h"
+#include "irqlog.h"
+#include "display.h"
+#include "journal.h"
+#include "usb_cmd.h"
+
+extern uint32_t __StackTop[], __StackBottom[];
+extern uint32_t __StackOneTop[], __StackOneBottom[];
+extern uint32_t __scratch_y_end__[];
+extern char __StackLimit[];
+extern char __data_start__[], __data_end__[];
+extern char __bss_start__[], __bss_end__[];
+extern char __end__[];
+extern char __flash_binary_start[], __flash_binary_end[];
+
+/**
+ * @brief Tabla estática cuyo tamaño depende de la configuración.
+ */
+typedef struct {
+    const char* name;
+    uint32_t bytes;
+} MemTable;
+
+static const MemTable tables[] = {
+    {"users", sizeof(users)},
+    {"account_overlay", (ACCOUNT_OVERLAY_SIZE + PROVISION_CACHE_SLOTS) * sizeof(AccountState)},
+    {"denominations", sizeof(denominations)},
+    {"keybuf", KEYBUF_SIZE * sizeof(KeyEvent)},
+    {"txn_log", TXN_LOG_SIZE * sizeof(TxnRecord)},
+    {"irqlog", IRQLOG_WORDS * sizeof(uint32_t)},
+    {"display", 2 * DISPLAY_ROWS * DISPLAY_COLS + DISPLAY_TX_MAX},
+    {"journal", sizeof(JournalPage)},
+    {"usb_line", USB_CMD_LINE_MAX},
+};
+
+static const char* const isr_names[MEMSTAT_ISR_COUNT] = {"gpio", "timer", "dma", "usb"};
+
+/**
+ * @brief Profundidad máxima de la pila al entrar a cada interrupción, en bytes (sin la pila del
+ * propio manejador).
+ */
+static volatile uint32_t isr_entry_depth_max[MEMSTAT_ISR_COUNT];
+
+static inline uint32_t current_sp(void) {
+    uint32_t sp;
+    __asm volatile("mov %0, sp" : "=r"(sp));
+    return sp;
+}
+
+void memstat_init() {
+    uint32_t ints = save_and_disable_interrupts();
+    uint32_t* limit = (uint32_t*)(current_sp() - MEMSTAT_PAINT_MARGIN);
+    for (uint32_t* p = __scratch_y_end__; p < limit; p++) {
+        *p = MEMSTAT_PAINT;
+    }
+    restore_interrupts(ints);
+
+    for (uint32_t* p = __StackOneBottom; p < __StackOneTop; p++) {
+        *p = MEMSTAT_PAINT;               // el núcleo 1 no se lanza: su pila queda sin tocar
+    }
+}
+
+void memstat_isr_sample(MemstatIsr isr) {
+    uint32_t depth = (uint32_t)__StackTop - current_sp();
+    if (depth > isr_entry_depth_max[isr]) {
+        isr_entry_depth_max[isr] = depth;
+    }
+}
+
+/**
+ * @brief Muestrea la pila al entrar a la interrupción USB; TinyUSB la atiende a continuación.
+ */
+static void usb_irq_sample(void) {
+    memstat_isr_sample(MEMSTAT_ISR_USB);
+}
+
+void memstat_usb_init() {
+    if (irq_has_shared_handler(USBCTRL_IRQ)) {
+        irq_add_shared_handler(USBCTRL_IRQ, usb_irq_sample, PICO_SHARED_IRQ_HANDLER_HIGHEST_ORDER_PRIORITY);
+    }
+}
+
+/**
+ * @brief Bytes de la pila usados alguna vez: desde el tope hasta la primera palabra sin el patrón.
+ */
+static uint32_t stack_used(const uint32_t* bottom, const uint32_t* top) {
+    const uint32_t* p = bottom;
+    while (p < top && *p == MEMSTAT_PAINT) {
+        p++;
+    }
+    return (uint32_t)(top - p) * sizeof(uint32_t);
+}
+
+void memstat_export_text() {
+    struct mallinfo heap = mallinfo();
+    uint32_t heap_top = (uint32_t)__end__ + heap.arena;
+    uint32_t ram_free = (uint32_t)__StackLimit - heap_top;
+    uint32_t core0_size = (uint32_t)__StackTop - (uint32_t)__StackBottom;
+    uint32_t core0_region = (uint32_t)__StackTop - (uint32_t)__scratch_y_end__;
+    uint32_t core0_used = stack_used(__scratch_y_end__, __StackTop);
+    uint32_t core1_size = (uint32_t)__StackOneTop - (uint32_t)__StackOneBottom;
+
+    printf("\n# mem flash=%lu data=%lu bss=%lu uninit=%lu heap=%lu heap_used=%lu ram_free=%lu\n",
+           (unsigned long)(__flash_binary_end - __flash_binary_start),
+           (unsigned long)(__data_end__ - __data_start__),
+           (unsigned long)(__bss_end__ - __bss_start__),
+           (unsigned long)(__bss_start__ - __data_end__),
+           (unsigned long)heap.arena, (unsigned long)heap.uordblks, (unsigned long)ram_free);
+    printf("# stack core0=%lu/%lu core0_region=%lu core1=%lu/%lu overflow=%d exhausted=%d\n",
+           (unsigned long)core0_used, (unsigned long)core0_size, (unsigned long)core0_region,
+           (unsigned long)stack_used(__StackOneBottom, __StackOneTop), (unsigned long)core1_size,
+           core0_used > core0_size, __scratch_y_end__[0] != MEMSTAT_PAINT);
+    printf("# isr_entry_depth");
+    for (int i = 0; i < MEMSTAT_ISR_COUNT; i++) {
+        printf(" %s=%lu", isr_names[i], (unsigned long)isr_entry_depth_max[i]);
+    }
+    printf(" usb_task=sin_muestrear");
+    printf("\n# tables");
+    for (size_t i = 0; i < count_of(tables); i++) {
+        printf(" %s=%lu", tables[i].name, (unsigned long)tables[i].bytes);
+    }
+    printf("\n# users slots=%u user_size=%u fit_in_free=%lu\n", NUM_USER_SLOTS, (unsigned)sizeof(User),
+           (unsigned long)(ram_free / sizeof(User)));
+}
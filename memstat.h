@@ -0,0 +1,76 @@
+/**
+ * @file memstat.h
+ * @brief Presupuesto de memoria: marcas de agua de las pilas y tamaños de las tablas estáticas.
+ * 
+ * Al arrancar se pintan con un patrón las pilas de ambos núcleos; la marca de agua es la primera
+ * palabra que ya no conserva el patrón. La pila del núcleo 0 se pinta hasta el comienzo de
+ * SCRATCH_Y y no solo hasta su tamaño reservado, porque nada le impide seguir creciendo por debajo
+ * de `__StackBottom`. Las interrupciones comparten la pila principal del núcleo 0; cada manejador
+ * registra además la profundidad de la pila al entrar, es decir, lo que ocupaba el código
+ * interrumpido más el marco que apila la excepción. Eso indica desde qué profundidad arranca cada
+ * interrupción, no cuánta pila consume el manejador: su propio uso solo queda cubierto por la marca
+ * de agua del núcleo 0, que es la cota que importa.
+ * 
+ * La interrupción del controlador USB se muestrea con un manejador compartido propio que corre
+ * antes del de TinyUSB. `tud_task()`, en cambio, corre en la interrupción de usuario exclusiva de
+ * `stdio_usb` y no se muestrea, y el informe lo indica.
+ * 
+ * El comando USB `mem` muestra las secciones del enlazador, la pila, el montículo y el tamaño de
+ * las tablas dimensionables (`NUM_USERS` y otras). El reparto de RAM y flash por módulo se genera
+ * al compilar (`tools/mem_report.cmake`).
+ */
+#ifndef MEMSTAT_H
+#define MEMSTAT_H
+
+#include <stdint.h>
+
+/**
+ * @brief Patrón con que se pintan las pilas.
+ */
+#define MEMSTAT_PAINT 0xA5A5A5A5u
+
+/**
+ * @brief Bytes por debajo del puntero de pila que no se pintan (marco de `memstat_init()`).
+ */
+#define MEMSTAT_PAINT_MARGIN 64
+
+/**
+ * @brief Interrupciones cuya profundidad de pila al entrar se muestrea.
+ */
+typedef enum {
+    MEMSTAT_ISR_GPIO,         /**< Flanco de columna del teclado */
+    MEMSTAT_ISR_TIMER,        /**< Alarma de escaneo de filas */
+    MEMSTAT_ISR_DMA,          /**< Fin de transferencia de la pantalla */
+    MEMSTAT_ISR_USB,          /**< Controlador USB (TinyUSB) */
+    MEMSTAT_ISR_COUNT
+} MemstatIsr;
+
+/**
+ * @brief Pinta la parte libre de la pila del núcleo 0 y la pila del núcleo 1.
+ * 
+ * Debe ser lo primero que haga `main()`.
+ */
+void memstat_init(void);
+
+/**
+ * @brief Agrega el muestreo a la interrupción del controlador USB.
+ * 
+ * Debe llamarse después de `stdio_init_all()`, que instala el manejador compartido de TinyUSB.
+ */
+void memstat_usb_init(void);
+
+/**
+ * @brief Registra la profundidad de la pila al entrar a una interrupción.
+ * 
+ * Debe llamarse al comienzo del manejador; no mide la pila que el manejador usa después.
+ * 
+ * @param isr Interrupción que llama.
+ */
+void memstat_isr_sample(MemstatIsr isr);
+
+/**
+ * @brief Muestra por USB el uso de RAM, flash, pilas y tablas estáticas.
+ */
+void memstat_export_text(void);
+
+#endif // MEMSTAT_H
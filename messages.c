@@ -0,0 +1,154 @@
+/**
+ * @file messages.c
+ * @brief Tablas del catálogo de mensajes y envío sin copia por la salida estándar y la pantalla.
+ */
+#include "messages.h"
+#include "display.h"
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * @brief Construye un bloque con longitud calculada en compilación.
+ */
+#define MSG_BLOB(s) {sizeof(s) - 1, s}
+
+/**
+ * @brief Mensajes en español.
+ */
+static const MsgTemplate catalog_es[MSG_COUNT] = {
+#define MSG(id, es, en, mode, lcd_es, lcd_en) \
+    [id] = {{MSG_BLOB(es), MSG_BLOB("")}, {MSG_BLOB(lcd_es), MSG_BLOB("")}, mode},
+#define MSG_FIELD(id, es_pre, es_post, en_pre, en_post, mode, lcd_es_pre, lcd_es_post, lcd_en_pre, lcd_en_post) \
+    [id] = {{MSG_BLOB(es_pre), MSG_BLOB(es_post)}, {MSG_BLOB(lcd_es_pre), MSG_BLOB(lcd_es_post)}, mode},
+#include "messages.def"
+#undef MSG
+#undef MSG_FIELD
+};
+
+/**
+ * @brief Mensajes en inglés.
+ */
+static const MsgTemplate catalog_en[MSG_COUNT] = {
+#define MSG(id, es, en, mode, lcd_es, lcd_en) \
+    [id] = {{MSG_BLOB(en), MSG_BLOB("")}, {MSG_BLOB(lcd_en), MSG_BLOB("")}, mode},
+#define MSG_FIELD(id, es_pre, es_post, en_pre, en_post, mode, lcd_es_pre, lcd_es_post, lcd_en_pre, lcd_en_post) \
+    [id] = {{MSG_BLOB(en_pre), MSG_BLOB(en_post)}, {MSG_BLOB(lcd_en_pre), MSG_BLOB(lcd_en_post)}, mode},
+#include "messages.def"
+#undef MSG
+#undef MSG_FIELD
+};
+
+/**
+ * @brief Tabla de catálogos indexada por idioma.
+ */
+static const MsgTemplate* const catalogs[MSG_LANG_COUNT] = {
+    [MSG_LANG_ES] = catalog_es,
+    [MSG_LANG_EN] = catalog_en,
+};
+
+/**
+ * @brief Catálogo del idioma activo.
+ */
+static const MsgTemplate* active = catalogs[MSG_DEFAULT_LANG];
+
+/**
+ * @brief Espacio para componer el texto del panel; 16x4 con saltos y acentos en UTF-8 cabe holgado.
+ */
+#define LCD_TEXT_MAX 96
+
+/**
+ * @brief Escribe un bloque directamente desde flash por la salida estándar.
+ */
+static inline void send_blob(const MsgBlob* blob) {
+    if (blob->len) {
+        fwrite(blob->text, 1, blob->len, stdout);
+    }
+}
+
+/**
+ * @brief Agrega `len` bytes a `buf` sin pasar de `LCD_TEXT_MAX`.
+ * 
+ * @return Nueva longitud de `buf`.
+ */
+static size_t append(char* buf, size_t n, const char* text, size_t len) {
+    if (len > LCD_TEXT_MAX - n) {
+        len = LCD_TEXT_MAX - n;
+    }
+    memcpy(buf + n, text, len);
+    return n + len;
+}
+
+/**
+ * @brief Envía una plantilla con su campo: el texto completo por la salida estándar y la versión
+ * corta como una pantalla del panel.
+ */
+static void send(MsgId id, const char* field, size_t len) {
+    const MsgTemplate* t = &active[id];
+    send_blob(&t->part[0]);
+    fwrite(field, 1, len, stdout);
+    send_blob(&t->part[1]);
+
+    char buf[LCD_TEXT_MAX];
+    size_t n = append(buf, 0, t->lcd[0].text, t->lcd[0].len);
+    n = append(buf, n, field, len);
+    n = append(buf, n, t->lcd[1].text, t->lcd[1].len);
+    display_show((DisplayMode)t->lcd_mode, buf, n);
+}
+
+/**
+ * @brief Escribe los dígitos de `value` de derecha a izquierda, terminando justo antes de `end`.
+ * 
+ * @return Puntero al primer carácter escrito.
+ */
+static char* format_unsigned(char* end, unsigned long value) {
+    do {
+        *--end = (char)('0' + value % 10);
+        value /= 10;
+    } while (value);
+    return end;
+}
+
+void msg_set_language(MsgLang lang) {
+    if (lang < MSG_LANG_COUNT) {
+        active = catalogs[lang];
+    }
+}
+
+void msg_send(MsgId id) {
+    send(id, "", 0);
+}
+
+void msg_send_text(MsgId id, const char* field) {
+    send(id, field, strlen(field));
+}
+
+void msg_send_int(MsgId id, long value) {
+    char buf[12];
+    char* end = buf + sizeof(buf);
+    char* start = format_unsigned(end, value < 0 ? -(unsigned long)value : (unsigned long)value);
+    if (value < 0) {
+        *--start = '-';
+    }
+    send(id, start, end - start);
+}
+
+void msg_send_amount(MsgId id, double amount) {
+    char buf[24];
+    char* end = buf + sizeof(buf);
+    bool negative = amount < 0;
+    unsigned long cents = (unsigned long)((negative ? -amount : amount) * 100.0 + 0.5);
+
+    char* start = format_unsigned(end - 3, cents / 100);
+    end[-3] = '.';
+    end[-2] = (char)('0' + (cents / 10) % 10);
+    end[-1] = (char)('0' + cents % 10);
+    if (negative) {
+        *--start = '-';
+    }
+    send(id, start, end - start);
+}
+
+void msg_echo(char c) {
+    putchar(c);
+    display_write(&c, 1);
+}
@@ -0,0 +1,109 @@
+/**
+ * @file messages.h
+ * @brief Catálogo de mensajes preformateados en flash.
+ * 
+ * Los textos de `messages.def` se convierten en compilación en tablas constantes (una por idioma)
+ * de bloques con longitud precalculada. Mostrar un mensaje es indexar la tabla y escribir el bloque
+ * tal cual desde flash, sin pasar por el formateo de `printf`. Los campos dinámicos se insertan
+ * entre las dos partes precalculadas de una plantilla.
+ * 
+ * La consola recibe el texto completo; el panel recibe una versión corta compuesta como una sola
+ * pantalla con `display_show()`. El eco de las teclas va a ambos.
+ */
+#ifndef MESSAGES_H
+#define MESSAGES_H
+
+#include "pico/stdlib.h"
+
+/**
+ * @brief Identificadores de mensaje, generados a partir de `messages.def`.
+ */
+typedef enum {
+#define MSG(id, es, en, mode, lcd_es, lcd_en) id,
+#define MSG_FIELD(id, es_pre, es_post, en_pre, en_post, mode, lcd_es_pre, lcd_es_post, lcd_en_pre, lcd_en_post) id,
+#include "messages.def"
+#undef MSG
+#undef MSG_FIELD
+    MSG_COUNT
+} MsgId;
+
+/**
+ * @brief Idiomas disponibles en el catálogo.
+ */
+typedef enum {
+    MSG_LANG_ES,    /**< Español */
+    MSG_LANG_EN,    /**< Inglés */
+    MSG_LANG_COUNT
+} MsgLang;
+
+/**
+ * @brief Idioma por defecto; puede cambiarse al compilar con `-DMSG_DEFAULT_LANG=MSG_LANG_EN`.
+ */
+#ifndef MSG_DEFAULT_LANG
+#define MSG_DEFAULT_LANG MSG_LANG_ES
+#endif
+
+/**
+ * @brief Bloque de texto en flash con su longitud precalculada.
+ */
+typedef struct {
+    uint16_t len;         /**< Longitud en bytes, sin terminador */
+    const char* text;     /**< Texto en flash */
+} MsgBlob;
+
+/**
+ * @brief Plantilla de mensaje: texto antes y después del campo dinámico, para la consola y para el
+ * panel.
+ */
+typedef struct {
+    MsgBlob part[2];      /**< Texto de la consola */
+    MsgBlob lcd[2];       /**< Texto corto del panel */
+    uint8_t lcd_mode;     /**< `DisplayMode` con el que se muestra en el panel */
+} MsgTemplate;
+
+/**
+ * @brief Selecciona el idioma de los mensajes.
+ * 
+ * @param lang Idioma a usar.
+ */
+void msg_set_language(MsgLang lang);
+
+/**
+ * @brief Envía un mensaje fijo.
+ * 
+ * @param id Mensaje a enviar.
+ */
+void msg_send(MsgId id);
+
+/**
+ * @brief Envía una plantilla insertando un texto (por ejemplo, el nombre del usuario).
+ * 
+ * @param id Plantilla a enviar.
+ * @param field Texto a insertar.
+ */
+void msg_send_text(MsgId id, const char* field);
+
+/**
+ * @brief Envía una plantilla insertando un entero.
+ * 
+ * @param id Plantilla a enviar.
+ * @param value Valor a insertar.
+ */
+void msg_send_int(MsgId id, long value);
+
+/**
+ * @brief Envía una plantilla insertando un monto con dos decimales.
+ * 
+ * @param id Plantilla a enviar.
+ * @param amount Monto a insertar.
+ */
+void msg_send_amount(MsgId id, double amount);
+
+/**
+ * @brief Envía el eco de una tecla.
+ * 
+ * @param c Carácter a enviar.
+ */
+void msg_echo(char c);
+
+#endif // MESSAGES_H
@@ -0,0 +1,182 @@
+/**
+ * @file metrics.c
+ * @brief Contadores, ventanas deslizantes e histogramas de operación del terminal.
+ */
+#include "metrics.h"
+#include "usb_cmd.h"
+
+/**
+ * @brief Número de series con ventana: contadores de sesión más una por denominación.
+ */
+#define METRICS_SERIES (METRIC_COUNT + NUM_DENOMINATIONS)
+
+/**
+ * @brief Ventana deslizante de una serie.
+ * 
+ * Cada cubeta guarda la época (número de periodo de `METRICS_BUCKET_SECONDS`) a la que pertenece;
+ * una cubeta de una época antigua se considera vacía.
+ */
+typedef struct {
+    uint32_t epoch[METRICS_WINDOW_BUCKETS];
+    uint16_t count[METRICS_WINDOW_BUCKETS];
+} MetricWindow;
+
+static uint32_t totals[METRICS_SERIES];
+static MetricWindow windows[METRICS_SERIES];
+static uint32_t session_hist[METRICS_HIST_BUCKETS];
+static uint32_t session_count = 0;
+static uint64_t session_total_s = 0;
+static absolute_time_t session_start;
+static bool session_open = false;
+static volatile uint32_t gauges[GAUGE_COUNT];
+
+/**
+ * @brief Época actual de la ventana deslizante.
+ */
+static uint32_t current_epoch(void) {
+    return (uint32_t)(time_us_64() / (1000000ull * METRICS_BUCKET_SECONDS));
+}
+
+/**
+ * @brief Incrementa una serie: una sola cubeta, costo constante.
+ */
+static void series_add(int series) {
+    uint32_t epoch = current_epoch();
+    MetricWindow* w = &windows[series];
+    int slot = epoch % METRICS_WINDOW_BUCKETS;
+
+    totals[series]++;
+    if (w->epoch[slot] != epoch) {
+        w->epoch[slot] = epoch;
+        w->count[slot] = 0;
+    }
+    if (w->count[slot] < UINT16_MAX) {
+        w->count[slot]++;
+    }
+}
+
+/**
+ * @brief Suma las cubetas vigentes de una serie (eventos en la última hora).
+ */
+static uint32_t series_window(int series, uint32_t epoch) {
+    const MetricWindow* w = &windows[series];
+    uint32_t sum = 0;
+    for (int i = 0; i < METRICS_WINDOW_BUCKETS; i++) {
+        if (w->count[i] != 0 && epoch - w->epoch[i] < METRICS_WINDOW_BUCKETS) {
+            sum += w->count[i];
+        }
+    }
+    return sum;
+}
+
+void metrics_count(MetricCounter counter) {
+    series_add(counter);
+}
+
+void metrics_withdrawal(int denomination_index) {
+    series_add(METRIC_COUNT + denomination_index);
+}
+
+void metrics_gauge_max(MetricGauge gauge, uint32_t value) {
+    if (value > gauges[gauge]) {
+        gauges[gauge] = value;
+    }
+}
+
+void metrics_gauge_set(MetricGauge gauge, uint32_t value) {
+    gauges[gauge] = value;
+}
+
+void metrics_session_start() {
+    session_start = get_absolute_time();
+    session_open = true;
+}
+
+void metrics_session_end() {
+    if (!session_open) {
+        return;
+    }
+    session_open = false;
+
+    uint32_t seconds = (uint32_t)(absolute_time_diff_us(session_start, get_absolute_time()) / 1000000);
+    int bucket = 0;
+    while (bucket < METRICS_HIST_BUCKETS - 1 && (seconds >> bucket) > 1) {
+        bucket++;                                    // cubeta k: hasta 2^k segundos
+    }
+    session_hist[bucket]++;
+    session_count++;
+    session_total_s += seconds;
+}
+
+/**
+ * @brief Nombres de los indicadores para la exportación de texto.
+ */
+static const char* const gauge_names[GAUGE_COUNT] = {
+    "isr_gpio_max_us", "isr_timer_max_us", "defer_latency_max_us", "defer_exec_max_us",
+    "defer_overruns", "defer_dropped", "display_bytes", "display_update_max_bytes",
+    "prearm_hits", "prearm_misses", "dispense_latency_us", "dispense_latency_max_us"
+};
+
+/**
+ * @brief Nombres de los contadores para la exportación de texto.
+ */
+static const char* const counter_names[METRIC_COUNT] = {
+    "login_ok", "login_failed", "unknown_id", "lockout", "timeout", "balance_query", "password_change"
+};
+
+void metrics_export_text() {
+    uint32_t epoch = current_epoch();
+
+    printf("\n# metrics uptime_s=%lu\n", (unsigned long)(time_us_64() / 1000000));
+    for (int i = 0; i < METRIC_COUNT; i++) {
+        printf("%s=%lu last_hour=%lu\n", counter_names[i],
+               (unsigned long)totals[i], (unsigned long)series_window(i, epoch));
+    }
+    for (int i = 0; i < NUM_DENOMINATIONS; i++) {
+        printf("withdraw_%.0f=%lu last_hour=%lu remaining=%d\n", denominations[i].amount,
+               (unsigned long)totals[METRIC_COUNT + i],
+               (unsigned long)series_window(METRIC_COUNT + i, epoch), denominations[i].quantity);
+    }
+    printf("sessions=%lu avg_session_s=%lu hist_pow2_s=",
+           (unsigned long)session_count,
+           (unsigned long)(session_count ? session_total_s / session_count : 0));
+    for (int i = 0; i < METRICS_HIST_BUCKETS; i++) {
+        printf(i ? ",%lu" : "%lu", (unsigned long)session_hist[i]);
+    }
+    printf("\n");
+    for (int i = 0; i < GAUGE_COUNT; i++) {
+        printf("%s=%lu\n", gauge_names[i], (unsigned long)gauges[i]);
+    }
+}
+
+void metrics_export_binary() {
+    uint32_t payload[1 + 2 * METRICS_SERIES + 2 + METRICS_HIST_BUCKETS + GAUGE_COUNT];
+    _Static_assert(sizeof(payload) <= UINT8_MAX, "la longitud del contenido no cabe en el byte de la cabecera");
+    uint32_t epoch = current_epoch();
+    int n = 0;
+
+    payload[n++] = (uint32_t)(time_us_64() / 1000000);
+    for (int i = 0; i < METRICS_SERIES; i++) {
+        payload[n++] = totals[i];
+        payload[n++] = series_window(i, epoch);
+    }
+    payload[n++] = session_count;
+    payload[n++] = (uint32_t)session_total_s;
+    for (int i = 0; i < METRICS_HIST_BUCKETS; i++) {
+        payload[n++] = session_hist[i];
+    }
+    for (int i = 0; i < GAUGE_COUNT; i++) {
+        payload[n++] = gauges[i];
+    }
+
+    uint32_t hash = 2166136261u;
+    const uint8_t* bytes = (const uint8_t*)payload;
+    for (size_t i = 0; i < sizeof(payload); i++) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+
+    const uint8_t header[4] = {'M', 'T', METRICS_FORMAT_VERSION, (uint8_t)sizeof(payload)};
+    usb_cmd_write_binary(header, sizeof(header));
+    usb_cmd_write_binary(payload, sizeof(payload));
+    usb_cmd_write_binary(&hash, sizeof(hash));
+}
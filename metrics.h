@@ -0,0 +1,121 @@
+/**
+ * @file metrics.h
+ * @brief Métricas operativas del terminal con memoria fija y actualizaciones O(1).
+ * 
+ * Mantiene contadores acumulados, tasas en ventana deslizante (una hora en cubetas de 5 minutos)
+ * e histogramas de duración de sesión. Las actualizaciones solo tocan una cubeta y nunca bloquean
+ * la máquina de estados; el costo de sumar la ventana se paga al exportar.
+ */
+#ifndef METRICS_H
+#define METRICS_H
+
+#include "pico/stdlib.h"
+#include "tcl.h"
+
+/**
+ * @brief Número de cubetas de la ventana deslizante.
+ */
+#define METRICS_WINDOW_BUCKETS 12
+
+/**
+ * @brief Duración de cada cubeta de la ventana, en segundos (12 x 5 min = 1 hora).
+ */
+#define METRICS_BUCKET_SECONDS 300
+
+/**
+ * @brief Número de cubetas del histograma de duración de sesión (potencias de 2 en segundos).
+ */
+#define METRICS_HIST_BUCKETS 8
+
+/**
+ * @brief Versión del formato binario de exportación.
+ */
+#define METRICS_FORMAT_VERSION 4
+
+/**
+ * @brief Contadores de eventos de sesión.
+ */
+typedef enum {
+    METRIC_LOGIN_OK,          /**< Inicios de sesión exitosos */
+    METRIC_LOGIN_FAILED,      /**< Contraseñas incorrectas */
+    METRIC_UNKNOWN_ID,        /**< IDs inexistentes o bloqueados */
+    METRIC_LOCKOUT,           /**< Bloqueos por `MAX_FAILED_ATTEMPTS` */
+    METRIC_TIMEOUT,           /**< Tiempos excedidos (`handle_timeout`) */
+    METRIC_BALANCE_QUERY,     /**< Consultas de saldo */
+    METRIC_PASSWORD_CHANGE,   /**< Cambios de contraseña */
+    METRIC_COUNT
+} MetricCounter;
+
+/**
+ * @brief Indicadores de peor caso (se actualizan también desde interrupciones).
+ */
+typedef enum {
+    GAUGE_ISR_GPIO_MAX_US,        /**< Duración máxima de `gpio_callback()` */
+    GAUGE_ISR_TIMER_MAX_US,       /**< Duración máxima de `timer_callback()` */
+    GAUGE_DEFER_LATENCY_MAX_US,   /**< Latencia máxima entre interrupción y manejador diferido */
+    GAUGE_DEFER_EXEC_MAX_US,      /**< Ejecución máxima de un manejador diferido */
+    GAUGE_DEFER_OVERRUNS,         /**< Manejadores que excedieron su presupuesto */
+    GAUGE_DEFER_DROPPED,          /**< Trabajos descartados por cola llena */
+    GAUGE_DISPLAY_BYTES,          /**< Bytes enviados a la pantalla */
+    GAUGE_DISPLAY_UPDATE_MAX_BYTES, /**< Bytes de la actualización de pantalla más grande */
+    GAUGE_PREARM_HITS,            /**< Retiros cuya denominación estaba preparada */
+    GAUGE_PREARM_MISSES,          /**< Retiros cuya denominación no estaba preparada */
+    GAUGE_DISPENSE_LATENCY_US,    /**< Latencia entre la tecla de monto y el pulso del último retiro */
+    GAUGE_DISPENSE_LATENCY_MAX_US, /**< Latencia máxima entre la tecla de monto y el pulso */
+    GAUGE_COUNT
+} MetricGauge;
+
+/**
+ * @brief Guarda el valor si supera al máximo registrado; seguro desde interrupciones.
+ * 
+ * @param gauge Indicador.
+ * @param value Valor observado.
+ */
+void metrics_gauge_max(MetricGauge gauge, uint32_t value);
+
+/**
+ * @brief Fija el valor de un indicador.
+ * 
+ * @param gauge Indicador.
+ * @param value Valor nuevo.
+ */
+void metrics_gauge_set(MetricGauge gauge, uint32_t value);
+
+/**
+ * @brief Incrementa un contador y su ventana deslizante.
+ * 
+ * @param counter Contador a incrementar.
+ */
+void metrics_count(MetricCounter counter);
+
+/**
+ * @brief Registra la entrega de un billete de la denominación indicada.
+ * 
+ * @param denomination_index Índice en `denominations`.
+ */
+void metrics_withdrawal(int denomination_index);
+
+/**
+ * @brief Marca el inicio de una sesión autenticada.
+ */
+void metrics_session_start(void);
+
+/**
+ * @brief Marca el fin de la sesión en curso; no hace nada si no había sesión.
+ */
+void metrics_session_end(void);
+
+/**
+ * @brief Exporta una instantánea legible (`clave=valor`) por la salida USB.
+ */
+void metrics_export_text(void);
+
+/**
+ * @brief Exporta una instantánea binaria compacta por la salida USB.
+ * 
+ * Formato (little-endian): "MT", versión (1 byte), longitud de la carga (1 byte), carga de palabras
+ * de 32 bits y suma FNV-1a de 32 bits de la carga. La carga termina con los `GAUGE_COUNT` indicadores.
+ */
+void metrics_export_binary(void);
+
+#endif // METRICS_H
@@ -0,0 +1,385 @@
+/**
+ * @file provision.c
+ * @brief Recepción incremental del archivo de cuentas y escritura por páginas en flash.
+ * 
+ * Cada banco guarda los registros desde su inicio y la cabecera en su último sector. Al comenzar
+ * una carga se borra la cabecera del banco inactivo; los bloques de datos se borran a medida que
+ * se llenan las páginas, y la cabecera se programa solo cuando todos los registros están escritos.
+ */
+#include "provision.h"
+#include <stdlib.h>
+#include "hardware/flash.h"
+#include "hardware/sync.h"
+#include "hardware/watchdog.h"
+
+/**
+ * @brief Bytes disponibles para registros en cada banco.
+ */
+#define BANK_RECORDS_BYTES (FLASH_PROVISION_BANK_SIZE - FLASH_SECTOR_SIZE)
+
+/**
+ * @brief Longitud máxima de un campo del CSV.
+ */
+#define FIELD_MAX 24
+
+/**
+ * @brief Tabla activa: banco, registros en flash y cantidad.
+ */
+static int active_bank = -1;
+static const ProvisionRecord* active_records = NULL;
+static uint32_t active_count = 0;
+static uint32_t active_generation = 0;
+
+/**
+ * @brief Estado de escritura del banco destino.
+ */
+static struct {
+    uint32_t base;                       /**< Desplazamiento del banco en flash */
+    uint32_t written;                    /**< Bytes de registros ya programados */
+    uint8_t page[FLASH_PAGE_SIZE];       /**< Página en construcción */
+    size_t fill;                         /**< Bytes ocupados de la página */
+    uint32_t count;                      /**< Registros aceptados */
+    uint32_t last_id;                    /**< Último ID aceptado (para verificar el orden) */
+    uint32_t hash;                       /**< FNV-1a de los registros */
+} writer;
+
+/**
+ * @brief Estado del analizador CSV.
+ */
+static struct {
+    char field[FIELD_MAX];
+    size_t len;
+    int index;                           /**< Campo actual (0 = id ... 3 = saldo) */
+    uint32_t line;
+    ProvisionRecord rec;
+} parser;
+
+/**
+ * @brief Resultado de procesar un carácter.
+ */
+typedef enum {
+    PARSE_MORE,
+    PARSE_RECORD,
+    PARSE_END,
+    PARSE_ERROR
+} ParseResult;
+
+static const char* parse_error = "";
+
+static uint32_t bank_offset(int bank) {
+    return FLASH_PROVISION_OFFSET + (uint32_t)bank * FLASH_PROVISION_BANK_SIZE;
+}
+
+static const ProvisionHeader* bank_header(int bank) {
+    return (const ProvisionHeader*)(XIP_BASE + bank_offset(bank) + BANK_RECORDS_BYTES);
+}
+
+static uint32_t fnv1a(uint32_t hash, const uint8_t* bytes, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+static uint32_t header_check(uint32_t generation, uint32_t count, uint32_t records_hash) {
+    return records_hash ^ (generation * 2654435761u) ^ count ^ PROVISION_MAGIC;
+}
+
+/**
+ * @brief Verifica la cabecera y la suma de los registros de un banco.
+ */
+static bool bank_valid(int bank) {
+    const ProvisionHeader* h = bank_header(bank);
+    if (h->magic != PROVISION_MAGIC || h->count > PROVISION_MAX_RECORDS) {
+        return false;
+    }
+    const uint8_t* records = (const uint8_t*)(XIP_BASE + bank_offset(bank));
+    uint32_t hash = fnv1a(2166136261u, records, h->count * sizeof(ProvisionRecord));
+    return h->check == header_check(h->generation, h->count, hash);
+}
+
+/**
+ * @brief Borra o programa flash con las interrupciones deshabilitadas.
+ */
+static void flash_erase(uint32_t offset, size_t len) {
+    uint32_t ints = save_and_disable_interrupts();
+    flash_range_erase(offset, len);
+    restore_interrupts(ints);
+}
+
+static void flash_program(uint32_t offset, const uint8_t* data) {
+    uint32_t ints = save_and_disable_interrupts();
+    flash_range_program(offset, data, FLASH_PAGE_SIZE);
+    restore_interrupts(ints);
+}
+
+void provision_init() {
+    active_bank = -1;
+    active_records = NULL;
+    active_count = 0;
+    active_generation = 0;
+
+    for (int bank = 0; bank < 2; bank++) {
+        if (bank_valid(bank) && (active_bank < 0 || bank_header(bank)->generation > active_generation)) {
+            active_bank = bank;
+            active_generation = bank_header(bank)->generation;
+        }
+    }
+    if (active_bank >= 0) {
+        active_records = (const ProvisionRecord*)(XIP_BASE + bank_offset(active_bank));
+        active_count = bank_header(active_bank)->count;
+    }
+}
+
+uint32_t provision_count() {
+    return active_count;
+}
+
+/**
+ * @brief Primera posición de la tabla activa cuyo ID es mayor o igual a `id`.
+ */
+static uint32_t lower_bound(uint32_t id) {
+    uint32_t lo = 0;
+    uint32_t hi = active_count;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (active_records[mid].id < id) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+const ProvisionRecord* provision_lookup(uint32_t id) {
+    uint32_t lo = lower_bound(id);
+    return (lo < active_count && active_records[lo].id == id) ? &active_records[lo] : NULL;
+}
+
+bool provision_any_in_range(uint32_t min_id, uint32_t max_id) {
+    uint32_t lo = lower_bound(min_id);
+    return lo < active_count && active_records[lo].id <= max_id;
+}
+
+void provision_to_user(const ProvisionRecord* rec, User* user) {
+    unsigned long id = rec->id <= PROVISION_ID_MAX ? rec->id : PROVISION_ID_MAX;   // la flash no es de fiar
+    memset(user, 0, sizeof(*user));
+    snprintf(user->id, sizeof(user->id), "%06lu", id);
+    memcpy(user->password, rec->password, PASSWORD_LENGTH);
+    memcpy(user->name, rec->name, PROVISION_NAME_LENGTH);
+    user->balance = rec->balance;
+    user->is_blocked = (rec->flags & 1) != 0;
+}
+
+/**
+ * @brief Programa la página en construcción, borrando antes el bloque si empieza uno nuevo.
+ */
+static void writer_flush_page(void) {
+    if (writer.written % FLASH_BLOCK_BYTES == 0) {
+        uint32_t len = BANK_RECORDS_BYTES - writer.written;
+        flash_erase(writer.base + writer.written, len < FLASH_BLOCK_BYTES ? len : FLASH_BLOCK_BYTES);
+    }
+    memset(writer.page + writer.fill, 0xFF, FLASH_PAGE_SIZE - writer.fill);
+    flash_program(writer.base + writer.written, writer.page);
+    writer.written += FLASH_PAGE_SIZE;
+    writer.fill = 0;
+    watchdog_update();
+}
+
+static void writer_begin(int bank) {
+    writer.base = bank_offset(bank);
+    writer.written = 0;
+    writer.fill = 0;
+    writer.count = 0;
+    writer.last_id = 0;
+    writer.hash = 2166136261u;
+    flash_erase(writer.base + BANK_RECORDS_BYTES, FLASH_SECTOR_SIZE);   // invalida el banco destino
+}
+
+static bool writer_add(const ProvisionRecord* rec) {
+    if (writer.count >= PROVISION_MAX_RECORDS) {
+        parse_error = "demasiadas cuentas";
+        return false;
+    }
+    if (writer.count > 0 && rec->id <= writer.last_id) {
+        parse_error = "ID fuera de orden o repetido";
+        return false;
+    }
+    memcpy(writer.page + writer.fill, rec, sizeof(*rec));
+    writer.fill += sizeof(*rec);
+    writer.hash = fnv1a(writer.hash, (const uint8_t*)rec, sizeof(*rec));
+    writer.last_id = rec->id;
+    writer.count++;
+    if (writer.fill == FLASH_PAGE_SIZE) {
+        writer_flush_page();
+    }
+    return true;
+}
+
+/**
+ * @brief Escribe la última página y la cabecera; a partir de aquí el banco es válido.
+ */
+static void writer_commit(int bank) {
+    if (writer.fill > 0) {
+        writer_flush_page();
+    }
+
+    uint8_t page[FLASH_PAGE_SIZE];
+    ProvisionHeader header = {
+        .magic = PROVISION_MAGIC,
+        .generation = active_generation + 1,
+        .count = writer.count,
+    };
+    header.check = header_check(header.generation, header.count, writer.hash);
+    memset(page, 0xFF, sizeof(page));
+    memcpy(page, &header, sizeof(header));
+    flash_program(writer.base + BANK_RECORDS_BYTES, page);
+
+    // Cambio de tabla: el banco nuevo queda activo de una sola vez.
+    active_records = (const ProvisionRecord*)(XIP_BASE + writer.base);
+    active_count = header.count;
+    active_generation = header.generation;
+    active_bank = bank;
+    accounts_cache_invalidate();
+}
+
+static bool all_digits(const char* s, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        if (s[i] < '0' || s[i] > '9') {
+            return false;
+        }
+    }
+    return len > 0;
+}
+
+/**
+ * @brief Valida y guarda el campo terminado en el registro en construcción.
+ */
+static bool parser_commit_field(void) {
+    ProvisionRecord* rec = &parser.rec;
+    char* f = parser.field;
+    size_t len = parser.len;
+
+    switch (parser.index) {
+        case 0:
+            if (len != ID_LENGTH || !all_digits(f, len)) {
+                parse_error = "ID invalido";
+                return false;
+            }
+            rec->id = strtoul(f, NULL, 10);
+            if (rec->id > PROVISION_ID_MAX) {
+                parse_error = "ID invalido";
+                return false;
+            }
+            break;
+        case 1:
+            if (len != PASSWORD_LENGTH) {
+                parse_error = "clave invalida";
+                return false;
+            }
+            memcpy(rec->password, f, PASSWORD_LENGTH);
+            break;
+        case 2:
+            if (len == 0 || len > PROVISION_NAME_LENGTH) {
+                parse_error = "nombre invalido";
+                return false;
+            }
+            memcpy(rec->name, f, len);
+            break;
+        case 3:
+            if (!all_digits(f, len) || len > 9) {
+                parse_error = "saldo invalido";
+                return false;
+            }
+            rec->balance = (int32_t)strtol(f, NULL, 10);
+            break;
+        default:
+            parse_error = "demasiados campos";
+            return false;
+    }
+    parser.index++;
+    parser.len = 0;
+    return true;
+}
+
+static void parser_reset_line(void) {
+    memset(&parser.rec, 0, sizeof(parser.rec));
+    parser.len = 0;
+    parser.index = 0;
+}
+
+/**
+ * @brief Procesa un carácter del flujo CSV.
+ */
+static ParseResult parser_feed(char c) {
+    if (c == '\r') {
+        return PARSE_MORE;
+    }
+    if (c == '\n') {
+        if (parser.index == 0 && parser.len == 1 && parser.field[0] == '.') {
+            return PARSE_END;
+        }
+        if (parser.index == 0 && parser.len == 0) {
+            parser.line++;                           // línea vacía
+            return PARSE_MORE;
+        }
+        if (!parser_commit_field()) {
+            return PARSE_ERROR;
+        }
+        if (parser.index != 4) {
+            parse_error = "faltan campos";
+            return PARSE_ERROR;
+        }
+        return PARSE_RECORD;
+    }
+    if (c == ',') {
+        return parser_commit_field() ? PARSE_MORE : PARSE_ERROR;
+    }
+    if (parser.len >= FIELD_MAX) {
+        parse_error = "campo demasiado largo";
+        return PARSE_ERROR;
+    }
+    parser.field[parser.len++] = c;
+    return PARSE_MORE;
+}
+
+void provision_receive() {
+    int bank = active_bank == 0 ? 1 : 0;
+    absolute_time_t start = get_absolute_time();
+
+    writer_begin(bank);
+    parser.line = 0;
+    parser_reset_line();
+    printf("READY\n");
+
+    while (true) {
+        int c = getchar_timeout_us(PROVISION_IDLE_TIMEOUT_MS * 1000);
+        watchdog_update();
+        if (c == PICO_ERROR_TIMEOUT) {
+            parse_error = "tiempo excedido";
+            break;
+        }
+
+        ParseResult result = parser_feed((char)c);
+        if (result == PARSE_RECORD) {
+            if (!writer_add(&parser.rec)) {
+                break;
+            }
+            parser.line++;
+            parser_reset_line();
+        } else if (result == PARSE_END) {
+            writer_commit(bank);
+            printf("OK %lu %lu\n", (unsigned long)writer.count,
+                   (unsigned long)(absolute_time_diff_us(start, get_absolute_time()) / 1000));
+            return;
+        } else if (result == PARSE_ERROR) {
+            break;
+        }
+    }
+
+    printf("ERR %lu %s\n", (unsigned long)parser.line + 1, parse_error);
+    while (getchar_timeout_us(100000) != PICO_ERROR_TIMEOUT) {
+        watchdog_update();      // descarta el resto del archivo para que no se interprete como comandos
+    }
+}
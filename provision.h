@@ -0,0 +1,127 @@
+/**
+ * @file provision.h
+ * @brief Aprovisionamiento masivo de cuentas por USB hacia un índice ordenado en flash.
+ * 
+ * Las cuentas se reciben como CSV (`id,clave,nombre,saldo`, una por línea, ordenadas por ID) y se
+ * analizan carácter a carácter con memoria constante. Los registros empaquetados se escriben en
+ * el banco inactivo por páginas de 256 bytes; la cabecera del banco se programa al final, de modo
+ * que el cambio de tabla es atómico: o se ve el banco completo o se sigue usando el anterior.
+ * 
+ * Protocolo: el anfitrión envía `provision` y el dispositivo responde `CODE <código>`; el código se
+ * teclea en el terminal seguido de '#'. Confirmado, el dispositivo responde `READY`, el anfitrión
+ * envía las líneas y termina con `.`, y el dispositivo responde `OK <cuentas> <ms>` o
+ * `ERR <línea> <motivo>`. Sin sesión en reposo o sin confirmación responde `ERR 0 <motivo>`.
+ */
+#ifndef PROVISION_H
+#define PROVISION_H
+
+#include "pico/stdlib.h"
+#include "tcl.h"
+#include "flash_layout.h"
+
+/**
+ * @brief Marca de una cabecera de banco válida.
+ */
+#define PROVISION_MAGIC 0x50524F56u
+
+/**
+ * @brief Tiempo para teclear el código de confirmación en el terminal, en milisegundos.
+ */
+#define PROVISION_CONFIRM_TIMEOUT_MS 60000
+
+/**
+ * @brief Dígitos del código de confirmación.
+ */
+#define PROVISION_CONFIRM_DIGITS 4
+
+/**
+ * @brief Tiempo máximo sin recibir datos antes de abortar, en milisegundos.
+ */
+#define PROVISION_IDLE_TIMEOUT_MS 5000
+
+/**
+ * @brief ID más alto que cabe en `ID_LENGTH` dígitos.
+ */
+#define PROVISION_ID_MAX 999999u
+
+/**
+ * @brief Longitud máxima del nombre almacenado en flash.
+ */
+#define PROVISION_NAME_LENGTH 19
+
+/**
+ * @brief Registro empaquetado de una cuenta aprovisionada (32 bytes).
+ */
+typedef struct {
+    uint32_t id;                          /**< ID numérico de 6 dígitos */
+    char password[PASSWORD_LENGTH];       /**< Clave, sin terminador */
+    int32_t balance;                      /**< Saldo inicial en pesos */
+    uint8_t flags;                        /**< Bit 0: cuenta bloqueada */
+    char name[PROVISION_NAME_LENGTH];     /**< Nombre, completado con ceros */
+} ProvisionRecord;
+
+/**
+ * @brief Cabecera de un banco, programada en el último sector del banco.
+ */
+typedef struct {
+    uint32_t magic;         /**< `PROVISION_MAGIC` */
+    uint32_t generation;    /**< Generación; el banco válido más reciente es el activo */
+    uint32_t count;         /**< Número de registros */
+    uint32_t check;         /**< Suma de verificación de la cabecera y los registros */
+} ProvisionHeader;
+
+/**
+ * @brief Número máximo de registros por banco (el último sector es la cabecera).
+ */
+#define PROVISION_MAX_RECORDS \
+    ((FLASH_PROVISION_BANK_SIZE - FLASH_SECTOR_SIZE) / sizeof(ProvisionRecord))
+
+/**
+ * @brief Selecciona el banco activo a partir de las cabeceras en flash.
+ * 
+ * Debe llamarse una vez al arrancar.
+ */
+void provision_init(void);
+
+/**
+ * @brief Número de cuentas en la tabla activa.
+ */
+uint32_t provision_count(void);
+
+/**
+ * @brief Busca una cuenta en la tabla activa mediante búsqueda binaria.
+ * 
+ * @param id ID numérico de la cuenta.
+ * @return Registro en flash, o NULL si no existe.
+ */
+const ProvisionRecord* provision_lookup(uint32_t id);
+
+/**
+ * @brief Indica si la tabla activa tiene alguna cuenta con ID en `[min_id, max_id]`.
+ * 
+ * Un prefijo de ID ingresado equivale a un rango numérico, por lo que basta una búsqueda binaria
+ * para saber si todavía puede completarse.
+ * 
+ * @param min_id Límite inferior (incluido).
+ * @param max_id Límite superior (incluido).
+ * @return true si hay al menos una cuenta en el rango.
+ */
+bool provision_any_in_range(uint32_t min_id, uint32_t max_id);
+
+/**
+ * @brief Copia un registro de flash al formato `User` en RAM.
+ * 
+ * @param rec Registro en flash.
+ * @param user Usuario destino.
+ */
+void provision_to_user(const ProvisionRecord* rec, User* user);
+
+/**
+ * @brief Recibe un archivo de cuentas por USB y lo activa si llega completo.
+ * 
+ * Bloquea el bucle principal durante la carga (el terminal está en modo de servicio) pero sigue
+ * alimentando el watchdog.
+ */
+void provision_receive(void);
+
+#endif // PROVISION_H
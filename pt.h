@@ -0,0 +1,113 @@
+/**
+ * @file pt.h
+ * @brief Protohilos: corrutinas sin pila basadas en continuaciones locales con `switch`.
+ * 
+ * Un protohilo es una función que se reanuda desde el punto donde se suspendió. No tiene pila
+ * propia, así que las variables que deben sobrevivir a una espera se guardan en una estructura
+ * de contexto y no en variables locales. Dentro de un protohilo no se puede usar `switch` ni
+ * `break` alrededor de una espera, porque las etiquetas `case` de las macros quedarían dentro.
+ */
+#ifndef PT_H
+#define PT_H
+
+#include <stdint.h>
+
+/**
+ * @brief Estado de un protohilo: la línea donde debe continuar.
+ */
+struct pt {
+    uint16_t lc;
+};
+
+/**
+ * @brief Valores de retorno de un protohilo.
+ */
+#define PT_WAITING 0
+#define PT_YIELDED 1
+#define PT_EXITED  2
+#define PT_ENDED   3
+
+/**
+ * @brief Declara una función protohilo.
+ */
+#define PT_THREAD(name_args) char name_args
+
+/**
+ * @brief Reinicia un protohilo para que la próxima ejecución empiece desde el principio.
+ */
+#define PT_INIT(pt) ((pt)->lc = 0)
+
+/**
+ * @brief Inicio del cuerpo de un protohilo.
+ */
+#define PT_BEGIN(pt) { char PT_YIELD_FLAG = 1; (void)PT_YIELD_FLAG; switch ((pt)->lc) { case 0:
+
+/**
+ * @brief Fin del cuerpo de un protohilo.
+ */
+#define PT_END(pt) } PT_YIELD_FLAG = 0; PT_INIT(pt); return PT_ENDED; }
+
+/**
+ * @brief Guarda el punto de continuación actual.
+ */
+#define PT_SET(pt) (pt)->lc = __LINE__; case __LINE__:
+
+/**
+ * @brief Suspende el protohilo hasta que se cumpla la condición (puede no suspenderse).
+ */
+#define PT_WAIT_UNTIL(pt, condition)         \
+    do {                                     \
+        PT_SET(pt)                           \
+        if (!(condition)) {                  \
+            return PT_WAITING;               \
+        }                                    \
+    } while (0)
+
+/**
+ * @brief Suspende el protohilo mientras se cumpla la condición.
+ */
+#define PT_WAIT_WHILE(pt, cond) PT_WAIT_UNTIL((pt), !(cond))
+
+/**
+ * @brief Indica si un protohilo sigue en ejecución según su valor de retorno.
+ */
+#define PT_SCHEDULE(f) ((f) < PT_EXITED)
+
+/**
+ * @brief Espera a que termine un protohilo hijo.
+ */
+#define PT_WAIT_THREAD(pt, thread) PT_WAIT_WHILE((pt), PT_SCHEDULE(thread))
+
+/**
+ * @brief Inicia un protohilo hijo y espera a que termine.
+ */
+#define PT_SPAWN(pt, child, thread)          \
+    do {                                     \
+        PT_INIT((child));                    \
+        PT_WAIT_THREAD((pt), (thread));      \
+    } while (0)
+
+/**
+ * @brief Cede el control al menos una vez y luego espera a que se cumpla la condición.
+ * 
+ * Garantiza que un evento ya consumido no se vuelva a procesar en la misma ejecución.
+ */
+#define PT_YIELD_UNTIL(pt, cond)                     \
+    do {                                             \
+        PT_YIELD_FLAG = 0;                           \
+        PT_SET(pt)                                   \
+        if ((PT_YIELD_FLAG == 0) || !(cond)) {       \
+            return PT_YIELDED;                       \
+        }                                            \
+    } while (0)
+
+/**
+ * @brief Termina el protohilo inmediatamente.
+ */
+#define PT_EXIT(pt)                          \
+    do {                                     \
+        PT_INIT(pt);                         \
+        return PT_EXITED;                    \
+    } while (0)
+
+#endif // PT_H
@@ -4,18 +4,150 @@
 #include "hardware/gpio.h"
 #include "hardware/timer.h"
 #include "hardware/irq.h"
+#include "pwm.h"
+#include "tcl.h"
+#include "metrics.h"
+
+// Motores preparados (bit i = denominación i)
+static uint32_t armed_mask = 0;
+
+// Instante a partir del cual cada motor puede volver a entregar
+static absolute_time_t ready_at[NUM_DENOMINATIONS];
+
+// Historial de elecciones de una cuenta por denominación (contadores saturados)
+typedef struct {
+    uint32_t account;
+    uint32_t last_used;
+    uint8_t counts[NUM_DENOMINATIONS];
+} ChoiceHistory;
+
+static ChoiceHistory choice_history[CHOICE_HISTORY_ACCOUNTS];
+static uint32_t history_clock = 0;
+
+static uint32_t prearm_hits = 0;
+static uint32_t prearm_misses = 0;
+
+// Instante de la tecla de monto del retiro en curso
+static absolute_time_t choice_time;
+
+// Busca la denominación asociada a un pin de motor
+static int denomination_of_pin(int motor_pin) {
+    for (int i = 0; i < NUM_DENOMINATIONS; i++) {
+        if (denominations[i].pinselect == motor_pin) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Historial de la cuenta; si no existe y `create`, reemplaza el menos reciente
+static ChoiceHistory* history_of(uint32_t account, bool create) {
+    ChoiceHistory* oldest = &choice_history[0];
+    for (int i = 0; i < CHOICE_HISTORY_ACCOUNTS; i++) {
+        ChoiceHistory* h = &choice_history[i];
+        if (h->last_used && h->account == account) {
+            h->last_used = ++history_clock;
+            return h;
+        }
+        if (h->last_used < oldest->last_used) {
+            oldest = h;
+        }
+    }
+    if (!create) {
+        return NULL;
+    }
+    memset(oldest, 0, sizeof(*oldest));
+    oldest->account = account;
+    oldest->last_used = ++history_clock;
+    return oldest;
+}
+
+// Configura el pin del motor como salida en reposo
+static void arm_motor(int index) {
+    int pin = denominations[index].pinselect;
+    gpio_init(pin);
+    gpio_set_dir(pin, GPIO_OUT);
+    gpio_put(pin, 0);
+    armed_mask |= 1u << index;
+}
 
 void mov_motors(int MOTOR_PIN) {
-    // Inicializar el pin del motor como salida
-    gpio_init(MOTOR_PIN);
-    gpio_set_dir(MOTOR_PIN, GPIO_OUT);
+    int index = denomination_of_pin(MOTOR_PIN);
+
+    // Inicializar el pin del motor como salida si no fue preparado
+    if (index < 0) {
+        gpio_init(MOTOR_PIN);
+        gpio_set_dir(MOTOR_PIN, GPIO_OUT);
+    } else {
+        if (!(armed_mask & (1u << index))) {
+            arm_motor(index);
+        }
+        sleep_until(ready_at[index]);   // solo espera si el motor sigue en reposo
+    }
 
         // Encender el motor
+        int64_t latency_us = absolute_time_diff_us(choice_time, get_absolute_time());
+        metrics_gauge_set(GAUGE_DISPENSE_LATENCY_US, (uint32_t)latency_us);
+        metrics_gauge_max(GAUGE_DISPENSE_LATENCY_MAX_US, (uint32_t)latency_us);
         gpio_put(MOTOR_PIN, 1);
-        sleep_ms(500);  // Mantener encendido 5 segundos
+        sleep_ms(MOTOR_PULSE_MS);  // Mantener encendido 500 ms
 
-        // Apagar el motor
+        // Apagar el motor; el reposo transcurre sin bloquear
         gpio_put(MOTOR_PIN, 0);
-        sleep_ms(5000);  // Mantener apagado 5 segundos
+        if (index >= 0) {
+            ready_at[index] = make_timeout_time_ms(MOTOR_COOLDOWN_MS);
+        } else {
+            sleep_ms(MOTOR_COOLDOWN_MS);
+        }
     
-}
\ No newline at end of file
+}
+
+void dispenser_prearm(uint32_t account, double balance) {
+    const ChoiceHistory* history = history_of(account, false);
+    static const uint8_t no_history[NUM_DENOMINATIONS];
+    const uint8_t* counts = history ? history->counts : no_history;
+    int order[NUM_DENOMINATIONS];
+    int count = 0;
+
+    // Candidatas: con billetes y que no superan el saldo, ordenadas por historial (inserción)
+    for (int i = 0; i < NUM_DENOMINATIONS; i++) {
+        if (denominations[i].quantity < 1 || denominations[i].amount > balance) {
+            continue;
+        }
+        int pos = count++;
+        while (pos > 0 && counts[order[pos - 1]] < counts[i]) {
+            order[pos] = order[pos - 1];
+            pos--;
+        }
+        order[pos] = i;
+    }
+
+    for (int i = 0; i < count && i < PREARM_CANDIDATES; i++) {
+        if (!(armed_mask & (1u << order[i]))) {
+            arm_motor(order[i]);
+        }
+    }
+}
+
+void dispenser_record_choice(uint32_t account, int denomination_index, absolute_time_t key_time) {
+    uint8_t* history = history_of(account, true)->counts;
+
+    choice_time = key_time;
+    if (armed_mask & (1u << denomination_index)) {
+        metrics_gauge_set(GAUGE_PREARM_HITS, ++prearm_hits);
+    } else {
+        metrics_gauge_set(GAUGE_PREARM_MISSES, ++prearm_misses);
+    }
+
+    // Al saturar se reduce a la mitad todo el historial para favorecer elecciones recientes
+    if (history[denomination_index] == UINT8_MAX) {
+        for (int i = 0; i < NUM_DENOMINATIONS; i++) {
+            history[i] >>= 1;
+        }
+    }
+    history[denomination_index]++;
+}
+
+void dispenser_cancel(void) {
+    armed_mask = 0;      // los pines quedan como salidas en bajo; basta con olvidar la preparación
+}
@@ -2,8 +2,74 @@
 #define PWM_H
 
 #include <stdint.h> // Para tipos como uint
+#include <stdbool.h>
+#include "pico/stdlib.h"
+
+/**
+ * @brief Duración del pulso que entrega un billete, en milisegundos.
+ */
+#define MOTOR_PULSE_MS 500
+
+/**
+ * @brief Tiempo de reposo de un motor entre dos entregas, en milisegundos.
+ */
+#define MOTOR_COOLDOWN_MS 5000
+
+/**
+ * @brief Número máximo de motores que se preparan de forma especulativa.
+ */
+#define PREARM_CANDIDATES 2
+
+/**
+ * @brief Número de cuentas cuyo historial de elecciones se conserva (se reemplaza la menos reciente).
+ */
+#define CHOICE_HISTORY_ACCOUNTS 16
 
 // Prototipos de funciones
+
+/**
+ * @brief Entrega un billete activando el motor indicado.
+ * 
+ * Si el motor no fue preparado lo configura en ese momento. Bloquea durante el pulso
+ * (`MOTOR_PULSE_MS`) y, si el mismo motor entregó hace menos de `MOTOR_COOLDOWN_MS`, lo que le
+ * falte de reposo. El reposo posterior al pulso transcurre sin bloquear: el motor sigue apagado
+ * ese tiempo, pero la sesión continúa.
+ * 
+ * @param motor_pin Pin GPIO del motor.
+ */
 void mov_motors(int motor_pin);
 
-#endif // PWM_H
\ No newline at end of file
+/**
+ * @brief Prepara los motores de las denominaciones que el usuario probablemente elegirá.
+ * 
+ * Se llama al abrir el menú de retiro. Ordena las denominaciones disponibles (con billetes y que
+ * no superan el saldo) según el historial de la cuenta y prepara las `PREARM_CANDIDATES` primeras.
+ * 
+ * El hardware no tiene nada que preparar: cada motor se enciende directamente con su pin, sin
+ * habilitación de driver ni arranque previo. Preparar solo configura el pin como salida en reposo
+ * (unas pocas escrituras de registro), así que la latencia de la tecla al billete no cambia de forma
+ * medible; los indicadores de aciertos y de latencia de las métricas lo confirman en campo.
+ * 
+ * @param account Número de cuenta del usuario.
+ * @param balance Saldo disponible.
+ */
+void dispenser_prearm(uint32_t account, double balance);
+
+/**
+ * @brief Registra la denominación elegida y cuenta si había sido preparada.
+ * 
+ * @param account Número de cuenta del usuario.
+ * @param denomination_index Denominación elegida.
+ * @param key_time Instante de pulsación de la tecla de monto; la latencia hasta el pulso del
+ *                 motor se mide desde aquí.
+ */
+void dispenser_record_choice(uint32_t account, int denomination_index, absolute_time_t key_time);
+
+/**
+ * @brief Descarta la preparación especulativa de los motores.
+ * 
+ * Se llama al terminar la sesión por cualquier motivo (retiro, salida, plazo vencido o error).
+ */
+void dispenser_cancel(void);
+
+#endif // PWM_H
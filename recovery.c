@@ -0,0 +1,94 @@
+/**
+ * @file recovery.c
+ * @brief Punto de control de la sesión en los registros scratch del watchdog.
+ * 
+ * Distribución de los registros (el SDK reserva scratch[4..7] para `watchdog_reboot`):
+ * - scratch[0]: `RECOVERY_MAGIC`.
+ * - scratch[1]: estado (bits 0-7) e índice de usuario (bits 8-15).
+ * - scratch[2]: suma de verificación de scratch[1].
+ * 
+ * Los retiros interrumpidos no se guardan aquí: los resuelve el registro de intenciones de
+ * `transaction.c`.
+ */
+#include "recovery.h"
+#include "tcl.h"
+#include "transaction.h"
+#include "messages.h"
+#include "metrics.h"
+#include "hardware/watchdog.h"
+
+/**
+ * @brief Último valor empaquetado escrito en scratch[1].
+ */
+static uint32_t last_packed = 0;
+
+/**
+ * @brief Calcula la suma de verificación del punto de control.
+ */
+static uint32_t checkpoint_sum(uint32_t packed) {
+    return ~(RECOVERY_MAGIC ^ packed);
+}
+
+/**
+ * @brief Escribe el punto de control completo en los registros scratch.
+ */
+static void checkpoint_write(uint32_t packed) {
+    watchdog_hw->scratch[0] = 0;                     // invalida mientras se escribe
+    watchdog_hw->scratch[1] = packed;
+    watchdog_hw->scratch[2] = checkpoint_sum(packed);
+    watchdog_hw->scratch[0] = RECOVERY_MAGIC;
+    last_packed = packed;
+}
+
+/**
+ * @brief Empaqueta el estado actual de la sesión.
+ */
+static uint32_t session_packed(void) {
+    uint32_t user_index = RECOVERY_NONE;
+    if (current_user != NULL) {
+        user_index = (uint32_t)(current_user - users);
+    }
+    return ((uint32_t)current_state & 0xFF) | (user_index << 8);
+}
+
+bool recovery_init() {
+    bool resumed = false;
+
+    if (watchdog_caused_reboot() && accounts_valid()) {
+        txn_recover();                               // un retiro interrumpido se anula o se confirma
+
+        uint32_t packed = watchdog_hw->scratch[1];
+        SystemState state = (SystemState)(packed & 0xFF);
+        uint8_t user_index = (packed >> 8) & 0xFF;
+
+        // Solo se reanudan sesiones autenticadas; una entrada a medias de ID o clave se descarta.
+        if (watchdog_hw->scratch[0] == RECOVERY_MAGIC &&
+            watchdog_hw->scratch[2] == checkpoint_sum(packed) &&
+            user_index < NUM_USER_SLOTS && state >= STATE_LOGGED_IN && !users[user_index].is_blocked) {
+            current_user = &users[user_index];
+            current_state = STATE_LOGGED_IN;
+            metrics_session_start();                 // las métricas no sobreviven al reinicio: la duración cuenta desde aquí
+            msg_send(MSG_SESSION_RESTORED);
+            show_menu();
+            resumed = true;
+        }
+    } else {
+        accounts_load_defaults();
+        txn_log_reset();
+    }
+
+    checkpoint_write(session_packed());
+    watchdog_enable(WATCHDOG_TIMEOUT_MS, true);
+    return resumed;
+}
+
+void recovery_poll() {
+    watchdog_update();
+    if (session_packed() != last_packed) {
+        recovery_checkpoint();
+    }
+}
+
+void recovery_checkpoint() {
+    checkpoint_write(session_packed());
+}
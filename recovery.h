@@ -0,0 +1,57 @@
+/**
+ * @file recovery.h
+ * @brief Supervisión por watchdog y recuperación rápida de la sesión tras un reinicio.
+ * 
+ * El estado crítico de la sesión (estado actual e índice del usuario) se guarda en los registros
+ * scratch del watchdog, que conservan su valor durante un reinicio provocado por el propio watchdog.
+ * Los saldos y casetes se conservan en RAM no inicializada (ver `tcl.c`) y el retiro en curso en el
+ * registro de intenciones (ver `transaction.h`).
+ */
+#ifndef RECOVERY_H
+#define RECOVERY_H
+
+#include "pico/stdlib.h"
+
+/**
+ * @brief Tiempo máximo sin alimentar el watchdog antes de reiniciar, en milisegundos.
+ * 
+ * La operación bloqueante más larga es el LED de acceso concedido (5 s). `mov_motors()` bloquea el
+ * pulso (0,5 s) y, si el mismo motor entregó hace menos de `MOTOR_COOLDOWN_MS`, lo que le falte de
+ * reposo, hasta 5,5 s en total. 8 s deja margen sobre ambos sin superar el máximo del RP2040 (~8,3 s).
+ */
+#define WATCHDOG_TIMEOUT_MS 8000
+
+/**
+ * @brief Marca que valida el punto de control guardado en los registros scratch.
+ */
+#define RECOVERY_MAGIC 0x43415348u
+
+/**
+ * @brief Valor que indica "sin usuario" en el punto de control.
+ */
+#define RECOVERY_NONE 0xFF
+
+/**
+ * @brief Inicializa el watchdog y, si el reinicio fue provocado por él, restaura la sesión.
+ * 
+ * Si el punto de control y los datos de cuentas son válidos, se omite la reinicialización completa:
+ * el retiro interrumpido se resuelve con `txn_recover()` y el usuario vuelve al menú principal. En caso contrario se
+ * cargan los valores de fábrica.
+ * 
+ * @return true si se reanudó una sesión y no debe mostrarse el mensaje de bienvenida.
+ */
+bool recovery_init(void);
+
+/**
+ * @brief Alimenta el watchdog y actualiza el punto de control si la sesión cambió.
+ * 
+ * Debe llamarse en cada iteración del bucle principal.
+ */
+void recovery_poll(void);
+
+/**
+ * @brief Guarda en el punto de control el estado actual de la sesión.
+ */
+void recovery_checkpoint(void);
+
+#endif // RECOVERY_H
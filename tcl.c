@@ -5,9 +5,20 @@
  * Este programa permite el ingreso de usuarios mediante ID y contraseña, con manejo de cambios de contraseñas 
  * y bloqueo de usuarios tras varios intentos fallidos.
  */
+#include <stdlib.h>
 #include "tcl.h"
 #include "s_luminosa.h"
 #include"pwm.h"
+#include "transaction.h"
+#include "metrics.h"
+#include "messages.h"
+#include "provision.h"
+#include "flow.h"
+#include "deferred.h"
+#include "irqlog.h"
+#include "journal.h"
+#include "memstat.h"
+#include "hardware/sync.h"
 
 /**
  * @brief Pines correspondientes a las filas del teclado matricial.
@@ -30,11 +41,12 @@ const char KEYPAD[4][4] = {
 };
 
 /**
- * @brief Estructura que define los usuarios del sistema.
+ * @brief Valores de fábrica de los usuarios del sistema.
  * 
- * Incluye ID, contraseña, nombre, intentos fallidos y estado de bloqueo.
+ * Incluye ID, contraseña, nombre, intentos fallidos y estado de bloqueo. Solo se copian a `users`
+ * en un arranque en frío.
  */
-User users[NUM_USERS] = {
+static const User default_users[NUM_USERS] = {
     {"123456", "1234", "Juan Pérez", 220000, 0, false},
     {"234567", "2345", "María García", 350000, 0, false},
     {"345678", "3456", "Carlos López", 10000, 0, false},
@@ -42,26 +54,38 @@ User users[NUM_USERS] = {
     {"567890", "5678", "Pedro Sánchez", 100000, 0, false}
 };
 
-Denomination denominations[] = {
+/**
+ * @brief Valores de fábrica de las denominaciones del dispensador.
+ */
+static const Denomination default_denominations[NUM_DENOMINATIONS] = {
     {10000, 5, 16},  // 5 billetes de 10,000
     {20000, 5, 18},  // 2 billetes de 20,000
     {50000, 5, 19},  // 2 billetes de 50,000
     {100000, 5, 20}, // 2 billetes de 100,000
 };
+
 /**
- * @brief Variable que indica si se ha presionado una tecla.
+ * @brief Usuarios del sistema.
+ * 
+ * Se ubican en RAM no inicializada para que saldos, intentos fallidos y bloqueos sobrevivan
+ * a un reinicio provocado por el watchdog.
  */
-volatile bool key_pressed = false;
+User __uninitialized_ram(users)[NUM_USER_SLOTS];
 
 /**
- * @brief Fila actual del teclado que está siendo escaneada.
+ * @brief Billetes disponibles por denominación (también en RAM no inicializada).
  */
-volatile uint8_t current_row = 0;
+Denomination __uninitialized_ram(denominations)[NUM_DENOMINATIONS];
 
 /**
- * @brief Última tecla presionada.
+ * @brief Marca que indica que `users` y `denominations` contienen datos válidos.
  */
-volatile char last_key = 0;
+static uint32_t __uninitialized_ram(accounts_magic);
+
+/**
+ * @brief Fila actual del teclado que está siendo escaneada.
+ */
+volatile uint8_t current_row = 0;
 
 /**
  * @brief Último tiempo en que se presionó una tecla.
@@ -69,74 +93,146 @@ volatile char last_key = 0;
 volatile absolute_time_t last_key_time;
 
 /**
- * @brief Almacena el ID ingresado por el usuario.
+ * @brief Estado actual del sistema.
  */
-char input_id[ID_LENGTH + 1] = {0};
+SystemState current_state = STATE_ENTER_ID;
 
 /**
- * @brief Almacena la contraseña ingresada por el usuario.
+ * @brief Puntero al usuario actualmente autenticado.
  */
-char input_password[PASSWORD_LENGTH + 1] = {0};
+User* current_user = NULL;
+
+int selected_index = 0;
 
 /**
- * @brief Almacena una nueva contraseña cuando el usuario desea cambiarla.
+ * @brief Siguiente ranura de caché a reutilizar para una cuenta aprovisionada.
  */
-char new_password[PASSWORD_LENGTH + 1] = {0};
+static int next_cache_slot = 0;
 
 /**
- * @brief Índice actual de entrada de datos (ID o contraseña).
+ * @brief Estado de cada ranura de caché tal como se leyó de flash, para saber si cambió.
  */
-int input_index = 0;
+static AccountState __uninitialized_ram(cache_loaded)[PROVISION_CACHE_SLOTS];
 
 /**
- * @brief Estado actual del sistema.
+ * @brief Superposición: estado de las cuentas aprovisionadas que difiere de su registro en flash.
+ * 
+ * Vive en RAM no inicializada junto a `users`, así que sobrevive a los mismos reinicios.
  */
-SystemState current_state = STATE_ENTER_ID;
+static AccountState __uninitialized_ram(account_overlay)[ACCOUNT_OVERLAY_SIZE];
 
 /**
- * @brief Tiempo de inicio de la entrada de datos actual.
+ * @brief Contexto del flujo de sesión: estado del protohilo, lector y entradas del usuario.
  */
-absolute_time_t input_start_time;
+typedef struct {
+    struct pt pt;                              /**< Protohilo del flujo */
+    InputReader reader;                        /**< Lector del paso actual */
+    char id[ID_LENGTH + 1];                    /**< ID ingresado */
+    char password[PASSWORD_LENGTH + 1];        /**< Contraseña ingresada o de confirmación */
+    char new_password[PASSWORD_LENGTH + 1];    /**< Nueva contraseña */
+    absolute_time_t menu_deadline;             /**< Plazo de inactividad en los menús */
+} SessionFlow;
 
 /**
- * @brief Puntero al usuario actualmente autenticado.
+ * @brief Flujo de la sesión del único teclado del terminal.
  */
-User* current_user = NULL;
+static SessionFlow session;
+
+/**
+ * @brief Instante en que se mostró el indicador del estado actual.
+ */
+static absolute_time_t prompt_time;
 
-int selected_index = 0;
 
 
+/**
+ * @brief Máscara de los pines de columna.
+ */
+static uint32_t col_mask = 0;
+
+/**
+ * @brief Identificador del trabajo diferido que decodifica las teclas.
+ */
+static int key_edge_job = -1;
+
+/**
+ * @brief Toma una copia coherente de la fila escaneada.
+ * 
+ * `timer_callback()` cambia los pines de fila y `current_row` con las interrupciones enmascaradas,
+ * y aquí se lee igual, así que la fila leída es la que está activa en los pines sin depender de
+ * las prioridades relativas de las interrupciones del GPIO y del temporizador, y sin esperas.
+ * 
+ * @return Fila activa.
+ */
+static uint8_t scan_snapshot(void) {
+    uint32_t ints = save_and_disable_interrupts();
+    uint8_t row = current_row;
+    restore_interrupts(ints);
+    return row;
+}
 
 /**
  * @brief timer_Callback para el temporizador que escanea las filas del teclado matricial.
  * 
+ * No avanza de fila mientras alguna columna esté en bajo: la tecla pulsada pertenece a la fila
+ * actual y la interrupción de columna aún puede estar pendiente.
+ * 
  * @param alarm_num Número del temporizador.
  */
 void timer_callback(uint alarm_num) {
-    gpio_put(ROW_PINS[current_row], 1);
-    current_row = (current_row + 1) % 4;
-    gpio_put(ROW_PINS[current_row], 0);
-    hardware_alarm_set_target(alarm_num, make_timeout_time_ms(5));
+    uint32_t start = time_us_32();
+    memstat_isr_sample(MEMSTAT_ISR_TIMER);
+    uint32_t levels = gpio_get_all() & col_mask;
+    uint8_t col_levels = 0;
+    for (int col = 0; col < 4; col++) {
+        col_levels |= ((levels >> COL_PINS[col]) & 1u) << col;
+    }
+    irqlog_alarm(col_levels, current_row);
+    if (levels == col_mask) {
+        uint32_t ints = save_and_disable_interrupts();
+        gpio_put(ROW_PINS[current_row], 1);
+        current_row = (current_row + 1) % 4;
+        gpio_put(ROW_PINS[current_row], 0);
+        restore_interrupts(ints);
+    }
+    hardware_alarm_set_target(alarm_num, make_timeout_time_ms(KEYPAD_SCAN_PERIOD_MS));
+    metrics_gauge_max(GAUGE_ISR_TIMER_MAX_US, time_us_32() - start);
 }
 
 /**
  * @brief gpio_Callback para manejar la interrupción de un pin de GPIO (tecla presionada).
  * 
+ * Solo toma la fila activa y encola el flanco; la decodificación se hace en `key_edge_handler()`.
+ * 
  * @param gpio Pin de GPIO que generó la interrupción.
  * @param events Eventos generados por el pin.
  */
 void gpio_callback(uint gpio, uint32_t events) {
+    uint32_t start = time_us_32();
+    memstat_isr_sample(MEMSTAT_ISR_GPIO);
+    uint8_t row = scan_snapshot();
+    irqlog_key_edge(gpio, row);
+    deferred_post(key_edge_job, gpio | ((uint32_t)row << 8));
+    metrics_gauge_max(GAUGE_ISR_GPIO_MAX_US, time_us_32() - start);
+}
+
+/**
+ * @brief Decodifica un flanco de columna en el bucle principal (trabajo diferido).
+ * 
+ * @param arg Pin de la columna (bits 0-7) y fila activa en la interrupción (bits 8-15).
+ * @param posted_at Instante de la interrupción.
+ */
+static void key_edge_handler(uint32_t arg, absolute_time_t posted_at) {
+    uint gpio = arg & 0xFF;
+    uint8_t row = (arg >> 8) & 0xFF;
+
     led_off_gpio12();                                   //------
-    if (!key_pressed) {
-        absolute_time_t current_time = get_absolute_time();
-        if (absolute_time_diff_us(last_key_time, current_time) > DEBOUNCE_DELAY) {
-            for (int col = 0; col < 4; col++) {
-                if (gpio == COL_PINS[col]) {
-                    last_key = KEYPAD[current_row][col];
-                    key_pressed = true;
-                    last_key_time = current_time;
-                    break;
-                }
+    if (absolute_time_diff_us(last_key_time, posted_at) > DEBOUNCE_DELAY) {
+        for (int col = 0; col < 4; col++) {
+            if (gpio == COL_PINS[col]) {
+                keybuf_push(KEYPAD[row][col], posted_at);   // se encola aunque el sistema esté ocupado
+                last_key_time = posted_at;
+                break;
             }
         }
     }
@@ -146,7 +242,9 @@ void gpio_callback(uint gpio, uint32_t events) {
  * @brief Inicializa el teclado matricial configurando los pines de filas y columnas.
  */
 void init_keypad() {
+    key_edge_job = deferred_register(key_edge_handler, DEFERRED_PRIO_HIGH, KEY_EDGE_BUDGET_US);
     for (int i = 0; i < 4; i++) {
+        col_mask |= 1u << COL_PINS[i];
         gpio_init(ROW_PINS[i]);
         gpio_set_dir(ROW_PINS[i], GPIO_OUT);
         gpio_put(ROW_PINS[i], 1);
@@ -159,7 +257,117 @@ void init_keypad() {
     
     hardware_alarm_claim(0);
     hardware_alarm_set_callback(0, timer_callback);
-    hardware_alarm_set_target(0, make_timeout_time_ms(5));
+    hardware_alarm_set_target(0, make_timeout_time_ms(KEYPAD_SCAN_PERIOD_MS));
+}
+
+/**
+ * @brief Carga los valores de fábrica de usuarios y denominaciones.
+ */
+void accounts_load_defaults() {
+    memset(users, 0, sizeof(users));
+    memset(cache_loaded, 0, sizeof(cache_loaded));
+    memset(account_overlay, 0, sizeof(account_overlay));
+    memcpy(users, default_users, sizeof(default_users));
+    memcpy(denominations, default_denominations, sizeof(denominations));
+    accounts_magic = ACCOUNTS_MAGIC;
+}
+
+/**
+ * @brief Verifica que los datos conservados en RAM tras un reinicio sean coherentes.
+ * 
+ * @return true si la marca es correcta y cada registro tiene cadenas terminadas y cantidades válidas.
+ */
+bool accounts_valid() {
+    if (accounts_magic != ACCOUNTS_MAGIC) {
+        return false;
+    }
+    for (int i = 0; i < NUM_USER_SLOTS; i++) {
+        if (users[i].id[ID_LENGTH] != '\0' ||
+            users[i].password[PASSWORD_LENGTH] != '\0' ||
+            memchr(users[i].name, '\0', sizeof(users[i].name)) == NULL ||
+            users[i].balance < 0) {
+            return false;
+        }
+    }
+    for (int i = 0; i < ACCOUNT_OVERLAY_SIZE; i++) {
+        if (account_overlay[i].used &&
+            (account_overlay[i].password[PASSWORD_LENGTH] != '\0' || account_overlay[i].balance < 0)) {
+            return false;
+        }
+    }
+    for (int i = 0; i < NUM_DENOMINATIONS; i++) {
+        if (denominations[i].quantity < 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Extrae de un usuario el estado que puede cambiar en el terminal.
+ */
+static void account_state_of(const User* user, AccountState* state) {
+    memset(state, 0, sizeof(*state));
+    state->account = (uint32_t)strtoul(user->id, NULL, 10);
+    memcpy(state->password, user->password, sizeof(state->password));
+    state->failed_attempts = user->failed_attempts;
+    state->is_blocked = user->is_blocked;
+    state->used = true;
+    state->balance = user->balance;
+}
+
+static bool account_state_equal(const AccountState* a, const AccountState* b) {
+    return a->account == b->account && strcmp(a->password, b->password) == 0 &&
+           a->failed_attempts == b->failed_attempts && a->is_blocked == b->is_blocked &&
+           a->balance == b->balance;
+}
+
+/**
+ * @brief Entrada de la superposición de la cuenta, o una libre si `create` (NULL si no hay).
+ */
+static AccountState* overlay_entry(uint32_t account, bool create) {
+    AccountState* free_entry = NULL;
+    for (int i = 0; i < ACCOUNT_OVERLAY_SIZE; i++) {
+        if (account_overlay[i].used && account_overlay[i].account == account) {
+            return &account_overlay[i];
+        }
+        if (!account_overlay[i].used && free_entry == NULL) {
+            free_entry = &account_overlay[i];
+        }
+    }
+    return create ? free_entry : NULL;
+}
+
+/**
+ * @brief Guarda en la superposición los cambios de una ranura de caché antes de reutilizarla.
+ * 
+ * @return false si la ranura tiene cambios y la superposición está llena.
+ */
+static bool cache_write_back(int slot) {
+    const User* user = &users[NUM_USERS + slot];
+    if (user->id[0] == '\0') {
+        return true;
+    }
+
+    AccountState now;
+    account_state_of(user, &now);
+    if (account_state_equal(&now, &cache_loaded[slot])) {
+        AccountState* entry = overlay_entry(now.account, false);
+        if (entry) {
+            entry->used = false;           // volvió a los valores de flash
+        }
+        return true;
+    }
+    AccountState* entry = overlay_entry(now.account, true);
+    if (entry == NULL) {
+        return false;
+    }
+    *entry = now;
+    return true;
+}
+
+uint32_t account_number(const User* user) {
+    return (uint32_t)strtoul(user->id, NULL, 10);
 }
 
 /**
@@ -169,35 +377,101 @@ void init_keypad() {
  * @return User* Puntero al usuario encontrado, o NULL si no existe.
  */
 User* find_user(const char* id) {     
-    for (int i = 0; i < NUM_USERS; i++) {
+    for (int i = 0; i < NUM_USER_SLOTS; i++) {
         if (strcmp(users[i].id, id) == 0) {
             return &users[i];
         }
     }
+
+    // Cuenta aprovisionada: se copia a la siguiente ranura de caché libre o más antigua
+    char* end;
+    unsigned long numeric_id = strtoul(id, &end, 10);
+    const ProvisionRecord* rec = NULL;
+    if (strlen(id) == ID_LENGTH && *end == '\0' && provision_count() > 0) {
+        rec = provision_lookup((uint32_t)numeric_id);
+    }
+    if (rec == NULL) {
+        return NULL;
+    }
+    for (int tries = 0; tries < PROVISION_CACHE_SLOTS; tries++) {
+        int slot = next_cache_slot;
+        User* user = &users[NUM_USERS + slot];
+        next_cache_slot = (next_cache_slot + 1) % PROVISION_CACHE_SLOTS;
+        if (user == current_user || !cache_write_back(slot)) {
+            continue;                      // en uso, o con cambios que no caben en la superposición
+        }
+
+        provision_to_user(rec, user);
+        account_state_of(user, &cache_loaded[slot]);
+        const AccountState* saved = overlay_entry(cache_loaded[slot].account, false);
+        if (saved) {
+            memcpy(user->password, saved->password, sizeof(user->password));
+            user->failed_attempts = saved->failed_attempts;
+            user->is_blocked = saved->is_blocked;
+            user->balance = saved->balance;
+        }
+        return user;
+    }
     return NULL;
 }
 
+bool id_prefix_possible(const char* prefix, uint8_t len) {
+    uint32_t value = 0;
+    for (uint8_t i = 0; i < len; i++) {
+        if (prefix[i] < '0' || prefix[i] > '9') {
+            return false;
+        }
+        value = value * 10 + (prefix[i] - '0');
+    }
+
+    for (int i = 0; i < NUM_USERS; i++) {
+        if (users[i].id[0] != '\0' && strncmp(users[i].id, prefix, len) == 0) {
+            return true;
+        }
+    }
+
+    // El prefijo abarca los IDs de 6 dígitos [valor * 10^k, (valor + 1) * 10^k - 1]
+    uint32_t span = 1;
+    for (uint8_t i = len; i < ID_LENGTH; i++) {
+        span *= 10;
+    }
+    return provision_any_in_range(value * span, value * span + span - 1);
+}
+
+void accounts_cache_invalidate() {
+    uint32_t keep = current_user ? account_number(current_user) : 0;
+    for (int i = NUM_USERS; i < NUM_USER_SLOTS; i++) {
+        if (&users[i] != current_user) {
+            memset(&users[i], 0, sizeof(users[i]));
+        }
+    }
+    for (int i = 0; i < ACCOUNT_OVERLAY_SIZE; i++) {
+        if (account_overlay[i].used && (current_user == NULL || account_overlay[i].account != keep)) {
+            account_overlay[i].used = false;       // el banco nuevo manda sobre los cambios anteriores
+        }
+    }
+}
+
 /**
  * @brief Reinicia el estado del sistema para un nuevo intento de inicio de sesión.
  */
 void reset_state() {
-    memset(input_id, 0, sizeof(input_id));
-    memset(input_password, 0, sizeof(input_password));
-    memset(new_password, 0, sizeof(new_password));
-    input_index = 0;
+    metrics_session_end();
+    keybuf_flush();                               // error o fin de sesión: se descartan teclas anticipadas
+    dispenser_cancel();                           // salida, plazo vencido o error: se olvida la preparación
+    memset(&session, 0, sizeof(session));         // borra las entradas y reinicia el flujo
     current_state = STATE_ENTER_ID;
     current_user = NULL;
-    input_start_time = get_absolute_time();
     led_on_gpio12_permanently();                  //----------
-            printf("Bienvenido a CashMate");
-            printf("\nIngrese su ID (6 digitos):\n");
+    msg_send(MSG_ENTER_ID);
 }
 
 /**
- * @brief Maneja el caso en que el tiempo para ingresar el ID o la contraseña ha sido excedido.
+ * @brief Maneja el caso en que se vence el plazo de un paso de la sesión (ID, contraseña o menú).
  */
 void handle_timeout() {
-    printf("\n¡Tiempo excedido! Por favor, intente de nuevo.\n");
+    metrics_count(METRIC_TIMEOUT);
+    msg_send(MSG_TIMEOUT);
     stop_blink();                         // apaga titileo si se demoro mucho ingresando la contraseña
     led_on_gpio11_2_seconds();                                      //------
     reset_state();
@@ -207,20 +481,10 @@ void handle_timeout() {
  * @brief Muestra el menú de opciones del usuario una vez que ha iniciado sesión.
  */
 void show_menu() {
-    printf("\nMateCash:\n");
-    printf("\nMenú de Usuario:\n");
-    printf("A - Retirar Dinero\n");
-    printf("B - Consultar Saldo\n");
-    printf("C - Cambiar Clave\n");
-    printf("D - Cerrar sesión\n");
+    msg_send(MSG_MAIN_MENU);
 }
 void amount_menu() {
-    printf("\nMateCash:\n");
-    printf("\nCuanto Dinero Desea retirar?:\n");
-    printf("A - 10.000\n");
-    printf("B - 20.000\n");
-    printf("C - 50.000\n");
-    printf("D - 100.000\n");
+    msg_send(MSG_AMOUNT_MENU);
 }
 
 /**
@@ -231,34 +495,39 @@ void amount_menu() {
 void process_logged_in_state(char key) {
     switch (key) {
         case 'A': // Retirar dinero
+            dispenser_prearm(account_number(current_user), current_user->balance);   // prepara los motores probables
             amount_menu();
             current_state = STATE_WITHDRAW_MONEY;
             break;
 
             break;
         case 'B': // Consultar saldo
-            printf("\nConsultando saldo...\n");
+            msg_send(MSG_CHECKING_BALANCE);
             current_state = STATE_CHECK_BALANCE;
+            metrics_count(METRIC_BALANCE_QUERY);
+            journal_log(JOURNAL_BALANCE, account_number(current_user), 0, (int32_t)current_user->balance);
             check_balance();
             break;
         case 'C':
-            printf("\nIngrese nueva contraseña de 4 dígitos:\n");
+            msg_send(MSG_NEW_PASSWORD);
             current_state = STATE_CHANGE_PASSWORD;
-            input_index = 0;
-            input_start_time = get_absolute_time();
             break;
         case 'D':
-            printf("\nCerrando sesión...\n");
+            msg_send(MSG_LOGOUT);
             reset_state();
             break;
         default:
-            printf("\nOpción no válida\n");
+            msg_send(MSG_INVALID_OPTION);
             led_on_gpio11_2_seconds();                            //--------------
+            keybuf_flush();
             show_menu();
             break;
     }
 }
-void amount_selection(char key) {
+void amount_selection(char key, absolute_time_t pressed_at) {
+    if (key >= 'A' && key <= 'D') {
+        dispenser_record_choice(account_number(current_user), key - 'A', pressed_at);
+    }
     switch (key) {
         case 'A': // Retirar dinero
             selected_index=0;
@@ -277,7 +546,8 @@ void amount_selection(char key) {
             withdraw_money();
             break;
         default:
-            printf("\nOpción no válida\n");
+            msg_send(MSG_INVALID_OPTION);
+            keybuf_flush();
            amount_menu();
             break;
     }
@@ -285,7 +555,7 @@ void amount_selection(char key) {
 
 void withdraw_money() {
     if (current_user->is_blocked) {
-        printf("\nError: Su cuenta está bloqueada.\n");
+        msg_send(MSG_ACCOUNT_BLOCKED);
         reset_state();
         return;
     }
@@ -295,25 +565,32 @@ void withdraw_money() {
 
     // Verificar disponibilidad de billetes
     if (selected->quantity < 1) {
-        printf("\nError: No hay billetes de %d disponibles. Intente con otra denominación.\n", selected->amount);
+        msg_send_int(MSG_NO_NOTES, (long)selected->amount);
         amount_menu();
         return;
     }
 
     // Verificar saldo suficiente
     if (selected->amount > current_user->balance) {
-        printf("\nError: Fondos insuficientes. Su saldo actual es %.2f\n", current_user->balance);
+        msg_send_amount(MSG_INSUFFICIENT_FUNDS, current_user->balance);
         amount_menu();
         return;
     }
 
 
-    // Realizar el retiro
-    mov_motors(selected->pinselect);
-    current_user->balance -= selected->amount;
-    selected->quantity -= 1;
+    // Realizar el retiro: reservar, dispensar y confirmar
+    Txn txn;
+    if (!txn_prepare(&txn, (int)(current_user - users), selected_index)) {
+        msg_send(MSG_RESERVE_FAILED);
+        amount_menu();
+        return;
+    }
+    txn_execute(&txn);
+    txn_commit(&txn);
+    dispenser_cancel();
+    metrics_withdrawal(selected_index);
 
-    printf("\nÉxito: Retiró %d. Retiro con el valor de %.2f\n", selected->amount); 
+    msg_send_int(MSG_WITHDRAW_OK, (long)selected->amount);
 
     // Mostrar balance actualizado
     current_state = STATE_CHECK_BALANCE;
@@ -323,135 +600,214 @@ void withdraw_money() {
 // Función para consultar el saldo
 void check_balance() {
     if (current_user->is_blocked) {
-        printf("\nError: Su cuenta está bloqueada.\n");
+        msg_send(MSG_ACCOUNT_BLOCKED);
         return;
     }
 
-    printf("\nSu saldo actual es: %.2f\n", current_user->balance);
-    printf("\nPresione '#' para finalizar");
+    msg_send_amount(MSG_BALANCE, current_user->balance);
 }
 /**
- * @brief Procesa la tecla presionada por el usuario según el estado actual del sistema.
+ * @brief Procesa una tecla en los estados de menú (una tecla por paso).
  * 
- * @param key Tecla presionada por el usuario.
+ * @param ev Tecla presionada por el usuario y su instante de pulsación.
  */
-void process_key(char key) {
-    absolute_time_t current_time = get_absolute_time();
-    
-    if (absolute_time_diff_us(input_start_time, current_time) > (MAX_INPUT_TIME_MS * 1000) &&
-        current_state == STATE_ENTER_PASSWORD) {
-        handle_timeout();
-        return;
+static void process_menu_key(const KeyEvent* ev) {
+    char key = ev->key;
+    if (current_state == STATE_LOGGED_IN) {
+        process_logged_in_state(key);
+    } else if (current_state == STATE_WITHDRAW_MONEY) {  // Maneja el retiro de dinero
+        amount_selection(key, ev->pressed_at);
+    } else if (current_state == STATE_CHECK_BALANCE) {   // Maneja la consulta de saldo
+        if (key == '#') { // Confirma para salir del estado
+            msg_send(MSG_GOODBYE);
+            reset_state();
+        } else {
+            check_balance();
+        }
     }
+}
 
-    switch (current_state) {
-        case STATE_ENTER_ID:
-            if (input_index < ID_LENGTH) {
-                input_id[input_index++] = key;
-                printf("%c", key);
-                if (input_index == ID_LENGTH) {
-                    input_id[ID_LENGTH] = '\0';
-                    current_user = find_user(input_id);
-                    if (current_user == NULL || current_user->is_blocked) {
-                        if (current_user && current_user->is_blocked) {
-                            printf("\n¡Usuario bloqueado! Contacte al administrador.\n");
-                            led_on_gpio11_2_seconds();                                           //----
-                        } else {
-                            printf("\nID de usuario no existe.\n");
-                            led_on_gpio11_2_seconds();                                           //-----
-                        }
-                        reset_state();
-                    } else {
-                        printf("\nIngrese contraseña de 4 dígitos:\n");
-                        start_blink();
-                        input_start_time = get_absolute_time();                                                       // titilea led amarillo
-                        current_state = STATE_ENTER_PASSWORD;
-                        input_index = 0;
-                    }
-                }
+/**
+ * @brief Busca el usuario del ID ingresado y comunica el error si no puede iniciar sesión.
+ * 
+ * @return true si el usuario existe y no está bloqueado.
+ */
+static bool lookup_user(const char* id) {
+    current_user = find_user(id);
+    if (current_user == NULL || current_user->is_blocked) {
+        metrics_count(METRIC_UNKNOWN_ID);
+        journal_log(JOURNAL_UNKNOWN_ID, (uint32_t)strtoul(id, NULL, 10), (uint8_t)strlen(id), 0);
+        if (current_user && current_user->is_blocked) {
+            msg_send(MSG_USER_BLOCKED);
+            led_on_gpio11_2_seconds();                                           //----
+        } else {
+            msg_send(MSG_UNKNOWN_ID);
+            led_on_gpio11_2_seconds();                                           //-----
+        }
+        reset_state();
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Verifica la contraseña ingresada, actualiza intentos y bloqueo, y muestra el menú.
+ * 
+ * @return true si la contraseña es correcta.
+ */
+static bool verify_password(const char* password) {
+    if (strcmp(current_user->password, password) == 0) {
+        msg_send_text(MSG_WELCOME_USER, current_user->name);
+        stop_blink();                                            // apaga titileo led amarillo
+        led_on_gpio10_5_seconds();                               //----
+        current_user->failed_attempts = 0;
+        metrics_count(METRIC_LOGIN_OK);
+        journal_log(JOURNAL_LOGIN, account_number(current_user), 0, 0);
+        metrics_session_start();
+        current_state = STATE_LOGGED_IN;
+        show_menu();
+        return true;
+    }
+
+    current_user->failed_attempts++;
+    metrics_count(METRIC_LOGIN_FAILED);
+    journal_log(JOURNAL_LOGIN_FAILED, account_number(current_user), current_user->failed_attempts, 0);
+    if (current_user->failed_attempts >= MAX_FAILED_ATTEMPTS) {
+        current_user->is_blocked = true;
+        metrics_count(METRIC_LOCKOUT);
+        journal_log(JOURNAL_LOCKOUT, account_number(current_user), 0, 0);
+        msg_send(MSG_LOCKED_OUT);
+        led_on_gpio11_2_seconds();                                               //-----
+    } else {
+        msg_send_int(MSG_WRONG_PASSWORD,
+                     MAX_FAILED_ATTEMPTS - current_user->failed_attempts);
+        stop_blink();                                                          // apaga titileo        
+        led_on_gpio11_2_seconds();                                             //----
+    }
+    reset_state();
+    return false;
+}
+
+/**
+ * @brief Flujo de la sesión escrito de forma secuencial.
+ * 
+ * Lee el ID (plazo desde la primera tecla, rechazado en cuanto ningún ID empieza con los dígitos
+ * ingresados), lo busca, lee la contraseña con plazo y luego atiende
+ * los menús con un plazo de inactividad; el cambio de contraseña lee y confirma 4 dígitos.
+ * Cualquier plazo vencido llama a `handle_timeout()`. Tras `reset_state()` el contexto queda en
+ * cero, por lo que el flujo vuelve a empezar por el ID.
+ */
+static PT_THREAD(session_flow(void* ctx, const KeyEvent* ev)) {
+    SessionFlow* s = (SessionFlow*)ctx;
+
+    PT_BEGIN(&s->pt);
+
+    while (true) {
+        if (current_user == NULL) {
+            current_state = STATE_ENTER_ID;
+            input_reader_setup(&s->reader, s->id, ID_LENGTH, false, MAX_INPUT_TIME_MS, true);
+            input_reader_set_validator(&s->reader, id_prefix_possible);   // rechaza el ID en la primera tecla imposible
+            PT_SPAWN(&s->pt, &s->reader.pt, input_read(&s->reader, ev));
+            if (s->reader.status == INPUT_TIMEOUT) {
+                handle_timeout();
+                continue;
+            }
+            if (!lookup_user(s->id)) {                           // también cubre INPUT_REJECTED
+                continue;
             }
-            break;
 
-        case STATE_ENTER_PASSWORD:
-            if (input_index < PASSWORD_LENGTH) {
-                input_password[input_index++] = key;
-                printf("*");
-                if (input_index == PASSWORD_LENGTH) {
-                    input_password[PASSWORD_LENGTH] = '\0';
-                    if (strcmp(current_user->password, input_password) == 0) {
-                        printf("\n\n¡Bienvenido, %s!\n", current_user->name);
-                        stop_blink();                                            // apaga titileo led amarillo
-                        led_on_gpio10_5_seconds();                               //----
-                        current_user->failed_attempts = 0;
-                        current_state = STATE_LOGGED_IN;
-                        show_menu();
-                    } else {
-                        current_user->failed_attempts++;
-                        if (current_user->failed_attempts >= MAX_FAILED_ATTEMPTS) {
-                            current_user->is_blocked = true;
-                            printf("\n\n¡Usuario bloqueado! Demasiados intentos fallidos.\n");
-                            led_on_gpio11_2_seconds();                                               //-----
-                        } else {
-                            printf("\n\nContraseña incorrecta. Intentos restantes: %d\n", 
-                                   MAX_FAILED_ATTEMPTS - current_user->failed_attempts);
-                            stop_blink();                                                          // apaga titileo        
-                            led_on_gpio11_2_seconds();                                             //----
-                        }
-                        reset_state();
-                    }
-                }
+            msg_send(MSG_ENTER_PASSWORD);
+            start_blink();                                       // titilea led amarillo
+            current_state = STATE_ENTER_PASSWORD;
+            input_reader_setup(&s->reader, s->password, PASSWORD_LENGTH, true, MAX_INPUT_TIME_MS, false);
+            PT_SPAWN(&s->pt, &s->reader.pt, input_read(&s->reader, ev));
+            if (s->reader.status == INPUT_TIMEOUT) {
+                handle_timeout();
+                continue;
             }
-            break;
+            if (!verify_password(s->password)) {
+                continue;
+            }
+        }
 
-        case STATE_LOGGED_IN:
-            process_logged_in_state(key);
-            break;
-        
-        case STATE_CHECK_BALANCE:  // Maneja la consulta de saldo
-        
-            if (key == '#') { // Confirma para salir del estado
-                printf("\nGracias por utilzar nuestros serivicos\n");
-                reset_state();
+        // Menús: una tecla por paso, con plazo de inactividad
+        s->menu_deadline = make_timeout_time_ms(MENU_TIMEOUT_MS);
+        PT_YIELD_UNTIL(&s->pt, ev != NULL || time_reached(s->menu_deadline));
+        if (ev == NULL) {
+            handle_timeout();
+            continue;
+        }
+        process_menu_key(ev);
+
+        if (current_state == STATE_CHANGE_PASSWORD) {
+            input_reader_setup(&s->reader, s->new_password, PASSWORD_LENGTH, true, MAX_INPUT_TIME_MS, false);
+            PT_SPAWN(&s->pt, &s->reader.pt, input_read(&s->reader, ev));
+            if (s->reader.status == INPUT_TIMEOUT) {
+                handle_timeout();
+                continue;
+            }
+
+            msg_send(MSG_CONFIRM_PASSWORD);
+            current_state = STATE_CONFIRM_PASSWORD;
+            input_reader_setup(&s->reader, s->password, PASSWORD_LENGTH, true, MAX_INPUT_TIME_MS, false);
+            PT_SPAWN(&s->pt, &s->reader.pt, input_read(&s->reader, ev));
+            if (s->reader.status == INPUT_TIMEOUT) {
+                handle_timeout();
+                continue;
+            }
 
+            if (strcmp(s->new_password, s->password) == 0) {
+                strcpy(current_user->password, s->new_password);
+                metrics_count(METRIC_PASSWORD_CHANGE);
+                journal_log(JOURNAL_PASSWORD_CHANGE, account_number(current_user), 0, 0);
+                msg_send(MSG_PASSWORD_CHANGED);
             } else {
-                check_balance();
+                msg_send(MSG_PASSWORD_MISMATCH);
             }
-        
-            break;
+            current_state = STATE_LOGGED_IN;
+            show_menu();
+        }
+    }
 
-        case STATE_WITHDRAW_MONEY:  // Maneja el retiro de dinero
-            amount_selection(key);
-            break;
+    PT_END(&s->pt);
+}
 
-        case STATE_CHANGE_PASSWORD:
-            if (input_index < PASSWORD_LENGTH) {
-                new_password[input_index++] = key;
-                printf("*");
-                if (input_index == PASSWORD_LENGTH) {
-                    printf("\nConfirme la nueva contraseña:\n");
-                    current_state = STATE_CONFIRM_PASSWORD;
-                    input_index = 0;
-                    memset(input_password, 0, sizeof(input_password));
-                }
-            }
-            break;
+/**
+ * @brief Registra el flujo de sesión en el planificador.
+ */
+void session_init() {
+    flow_register(session_flow, &session);
+}
 
-        case STATE_CONFIRM_PASSWORD:
-            if (input_index < PASSWORD_LENGTH) {
-                input_password[input_index++] = key;
-                printf("*");
-                if (input_index == PASSWORD_LENGTH) {
-                    if (strcmp(new_password, input_password) == 0) {
-                        strcpy(current_user->password, new_password);
-                        printf("\n¡Contraseña cambiada exitosamente!\n");
-                    } else {
-                        printf("\nLas contraseñas no coinciden. Intente de nuevo.\n");
-                    }
-                    current_state = STATE_LOGGED_IN;
-                    show_menu();
-                }
-            }
-            break;
+/**
+ * @brief Indica si no hay sesión abierta ni teclas del ID en curso.
+ */
+bool session_idle() {
+    return current_user == NULL && current_state == STATE_ENTER_ID && session.reader.count == 0 &&
+           !session.reader.armed;
+}
+
+/**
+ * @brief Indica si el estado espera una opción de menú en lugar de dígitos.
+ */
+static bool is_menu_state(SystemState state) {
+    return state == STATE_LOGGED_IN || state == STATE_WITHDRAW_MONEY || state == STATE_CHECK_BALANCE;
+}
+
+/**
+ * @brief Procesa una tecla de la cola de teclas anticipadas.
+ * 
+ * @param ev Tecla y su instante de pulsación.
+ */
+void process_key_event(const KeyEvent* ev) {
+    bool typed_ahead = absolute_time_diff_us(prompt_time, ev->pressed_at) < 0;
+    if (typed_ahead && is_menu_state(current_state) && ev->key >= '0' && ev->key <= '9') {
+        return;
+    }
 
+    SystemState before = current_state;
+    flow_run(ev);
+    if (current_state != before) {
+        prompt_time = get_absolute_time();
     }
 }
@@ -16,17 +16,43 @@
 #include "hardware/gpio.h"
 #include "hardware/timer.h"
 #include "hardware/irq.h"
+#include "keybuf.h"
 
 /**
  * @brief Tiempo de retardo para el debounce de los botones, en microsegundos.
  */
 #define DEBOUNCE_DELAY 200000
 
+/**
+ * @brief Período del escaneo de filas del teclado, en milisegundos.
+ */
+#define KEYPAD_SCAN_PERIOD_MS 5
+
+/**
+ * @brief Presupuesto de ejecución del trabajo diferido que decodifica una tecla, en microsegundos.
+ */
+#define KEY_EDGE_BUDGET_US 100
+
 /**
  * @brief Número máximo de usuarios permitidos en el sistema de datos.
  */
 #define NUM_USERS 5
 
+/**
+ * @brief Ranuras de RAM para cuentas cargadas desde la tabla aprovisionada en flash.
+ */
+#define PROVISION_CACHE_SLOTS 4
+
+/**
+ * @brief Total de ranuras de `users`: usuarios residentes seguidos de la caché de flash.
+ */
+#define NUM_USER_SLOTS (NUM_USERS + PROVISION_CACHE_SLOTS)
+
+/**
+ * @brief Cuentas aprovisionadas cuyo estado modificado se conserva fuera de la caché.
+ */
+#define ACCOUNT_OVERLAY_SIZE 128
+
 /**
  * @brief Longitud del ID de usuario.
  */
@@ -42,11 +68,26 @@
  */
 #define MAX_INPUT_TIME_MS 20000
 
+/**
+ * @brief Tiempo máximo de inactividad en los menús antes de cerrar la sesión, en milisegundos.
+ */
+#define MENU_TIMEOUT_MS 60000
+
 /**
  * @brief Número máximo de intentos fallidos antes de bloquear a un usuario.
  */
 #define MAX_FAILED_ATTEMPTS 3
 
+/**
+ * @brief Número de denominaciones (casetes) del dispensador.
+ */
+#define NUM_DENOMINATIONS 4
+
+/**
+ * @brief Marca que valida los datos de cuentas conservados en RAM entre reinicios.
+ */
+#define ACCOUNTS_MAGIC 0x41434354u
+
 /**
  * @brief Pines GPIO utilizados para las filas del teclado matricial.
  */
@@ -87,6 +128,20 @@ typedef struct {
     bool is_blocked;                        /**< Indica si el usuario está bloqueado */
 } User;
 
+/**
+ * @brief Estado de una cuenta aprovisionada que puede cambiar en el terminal.
+ * 
+ * Es lo que se conserva en la superposición cuando difiere del registro en flash.
+ */
+typedef struct {
+    uint32_t account;                       /**< Número de cuenta */
+    char password[PASSWORD_LENGTH + 1];     /**< Contraseña */
+    uint8_t failed_attempts;                /**< Intentos fallidos */
+    bool is_blocked;                        /**< Bloqueo */
+    bool used;                              /**< Entrada ocupada */
+    double balance;                         /**< Saldo */
+} AccountState;
+
 typedef struct {
     double amount;   // Valor del billete
     int quantity; // Cantidad de billetes disponibles
@@ -94,55 +149,33 @@ typedef struct {
 } Denomination;
 
 /**
- * @brief Indica si se ha presionado una tecla.
+ * @brief Usuarios del sistema (conservados en RAM entre reinicios por watchdog).
+ * 
+ * Las primeras `NUM_USERS` ranuras son los usuarios residentes; las demás guardan las cuentas
+ * aprovisionadas en flash que se usaron recientemente.
  */
-extern volatile bool key_pressed;
+extern User users[NUM_USER_SLOTS];
 
 /**
- * @brief Fila actual escaneada en el teclado matricial.
+ * @brief Denominaciones disponibles en el dispensador.
  */
-extern volatile uint8_t current_row;
+extern Denomination denominations[NUM_DENOMINATIONS];
 
 /**
- * @brief Última tecla presionada en el teclado matricial.
+ * @brief Fila actual escaneada en el teclado matricial.
  */
-extern volatile char last_key;
+extern volatile uint8_t current_row;
 
 /**
  * @brief Tiempo en el que se presionó la última tecla.
  */
 extern volatile absolute_time_t last_key_time;
 
-/**
- * @brief Buffer para almacenar el ID de usuario ingresado.
- */
-extern char input_id[ID_LENGTH + 1];
-
-/**
- * @brief Buffer para almacenar la contraseña ingresada.
- */
-extern char input_password[PASSWORD_LENGTH + 1];
-
-/**
- * @brief Buffer para almacenar la nueva contraseña al cambiarla.
- */
-extern char new_password[PASSWORD_LENGTH + 1];
-
-/**
- * @brief Índice actual del input ingresado.
- */
-extern int input_index;
-
 /**
  * @brief Estado actual del sistema.
  */
 extern SystemState current_state;
 
-/**
- * @brief Tiempo de inicio del input actual.
- */
-extern absolute_time_t input_start_time;
-
 /**
  * @brief Puntero al usuario actual que está interactuando con el sistema.
  */
@@ -168,21 +201,67 @@ void gpio_callback(uint gpio, uint32_t events);
  */
 void init_keypad(void);
 
+/**
+ * @brief Copia los valores de fábrica a `users` y `denominations` (arranque en frío).
+ */
+void accounts_load_defaults(void);
+
+/**
+ * @brief Indica si `users` y `denominations` conservan datos válidos tras un reinicio.
+ * 
+ * @return true si los datos pueden reutilizarse sin reinicializarlos.
+ */
+bool accounts_valid(void);
+
+/**
+ * @brief Descarta el estado en RAM de las cuentas aprovisionadas tras activar un banco nuevo.
+ * 
+ * Vacía las ranuras de caché y la superposición, salvo las del usuario actual: el banco recién
+ * aprovisionado es la referencia de saldos, claves y bloqueos, y los cambios hechos en el terminal
+ * sobre el banco anterior no se aplican encima.
+ */
+void accounts_cache_invalidate(void);
+
+/**
+ * @brief ID numérico de una cuenta, para el diario.
+ * 
+ * @param user Usuario de la cuenta.
+ * @return El ID del usuario como número.
+ */
+uint32_t account_number(const User* user);
+
 /**
  * @brief Busca un usuario en la base de datos de usuarios según su ID.
  * 
+ * Busca primero en `users` y luego en la tabla aprovisionada en flash; una cuenta encontrada en
+ * flash se copia a una ranura de caché y se le aplica su estado de la superposición. Al desalojar
+ * una ranura, su saldo, intentos fallidos, bloqueo y contraseña pasan a la superposición si
+ * difieren de los cargados desde flash, por lo que el desalojo no revierte retiros ni bloqueos; un
+ * nuevo aprovisionamiento sí los reemplaza (ver `accounts_cache_invalidate()`). Si la superposición
+ * está llena, las ranuras con cambios no se desalojan y, si ninguna puede reutilizarse, la cuenta
+ * no se carga.
+ * 
  * @param id El ID del usuario que se busca.
  * @return Puntero al usuario encontrado, o NULL si no se encuentra.
  */
 User* find_user(const char* id);
 
+/**
+ * @brief Indica si algún usuario (residente o aprovisionado) tiene un ID que empieza con `prefix`.
+ * 
+ * @param prefix Dígitos ingresados.
+ * @param len Cantidad de dígitos.
+ * @return false si ningún ID puede completarse a partir del prefijo.
+ */
+bool id_prefix_possible(const char* prefix, uint8_t len);
+
 /**
  * @brief Reinicia el estado del sistema para un nuevo intento de inicio de sesión.
  */
 void reset_state(void);
 
 /**
- * @brief Maneja el caso en que el tiempo para ingresar el ID o la contraseña ha sido excedido.
+ * @brief Maneja el caso en que se vence el plazo de un paso de la sesión (ID, contraseña o menú).
  */
 void handle_timeout(void);
 
@@ -197,14 +276,35 @@ void amount_menu(void);
  * @param key Tecla presionada por el usuario.
  */
 void process_logged_in_state(char key);
-void amount_selection(char key);
-
 /**
- * @brief Procesa la tecla presionada por el usuario según el estado actual del sistema.
+ * @brief Procesa la elección de monto en el menú de retiro.
  * 
  * @param key Tecla presionada por el usuario.
+ * @param pressed_at Instante de pulsación, desde el que se mide la latencia hasta el billete.
+ */
+void amount_selection(char key, absolute_time_t pressed_at);
+
+/**
+ * @brief Registra el flujo de sesión; debe llamarse una vez al arrancar, tras `recovery_init()`.
+ */
+void session_init(void);
+
+/**
+ * @brief Indica si no hay sesión abierta ni teclas del ID en curso (reposo del terminal).
+ */
+bool session_idle(void);
+
+/**
+ * @brief Procesa una tecla de la cola de teclas anticipadas.
+ * 
+ * Los dígitos pulsados antes de que apareciera un menú (por ejemplo, durante el LED de bienvenida)
+ * se ignoran sin penalización; el resto reanuda el flujo de sesión en orden, de modo que los
+ * dígitos anticipados pasan al siguiente campo de entrada. Sin teclas, el bucle principal llama a
+ * `flow_run(NULL)` para que venzan los plazos.
+ * 
+ * @param ev Tecla y su instante de pulsación.
  */
-void process_key(char key);
+void process_key_event(const KeyEvent* ev);
 void withdraw_money();
 void check_balance();
 
@@ -0,0 +1,225 @@
+/**
+ * @file display_sim.c
+ * @brief Simulador de la pantalla en el anfitrión (herramienta para Linux).
+ * 
+ * Compila `display.c` con un puerto simulado que decodifica el flujo serie del ST7920 en una
+ * memoria de texto virtual, de modo que lo que se dibuja es lo que recibiría el panel real. Cada
+ * línea de la entrada es un mensaje, sin su fin de línea (`\n` escrito dentro de la línea es un
+ * salto): si empieza por `=` se muestra como pantalla nueva (`DISPLAY_SCREEN`), si empieza por `+`
+ * debajo de lo mostrado (`DISPLAY_BELOW`) y si no se escribe como eco. Tras cada una se muestra el
+ * panel y los bytes transferidos, y al final un resumen frente a redibujar todo.
+ * 
+ * Con `--catalog` muestra los textos del panel de `messages.def` en todos los idiomas, con un campo
+ * de ejemplo, y falla si alguno parte una palabra o no cabe en 16x4.
+ * 
+ * Compilación: cc -O2 -I. -o display_sim tools/display_sim.c display.c
+ * Uso:         display_sim < mensajes.txt
+ *              display_sim -o panel.txt < mensajes.txt
+ *              display_sim --catalog
+ */
+#include "display.h"
+#include <stdio.h>
+#include <string.h>
+
+#define LINE_MAX_LEN 512
+#define CATALOG_FIELD "1234567.89"
+
+/**
+ * @brief Textos del panel de un mensaje del catálogo, sin el campo.
+ */
+typedef struct {
+    const char* name;
+    DisplayMode mode;
+    bool field;
+    const char* lcd[2][2];      /**< [idioma][antes, después] */
+} CatalogEntry;
+
+static const CatalogEntry catalog[] = {
+#define MSG(id, es, en, mode, lcd_es, lcd_en) {#id, mode, false, {{lcd_es, ""}, {lcd_en, ""}}},
+#define MSG_FIELD(id, es_pre, es_post, en_pre, en_post, mode, lcd_es_pre, lcd_es_post, lcd_en_pre, lcd_en_post) \
+    {#id, mode, true, {{lcd_es_pre, lcd_es_post}, {lcd_en_pre, lcd_en_post}}},
+#include "messages.def"
+#undef MSG
+#undef MSG_FIELD
+};
+
+/**
+ * @brief Memoria de texto del ST7920: 32 palabras de 2 caracteres.
+ */
+static char ddram[64];
+static int address = 0;
+static bool pending_done = false;
+static unsigned long update_bytes = 0;
+
+/**
+ * @brief Posición en `ddram` del inicio de cada fila (direcciones 0x80, 0x90, 0x88, 0x98).
+ */
+static const int row_start[DISPLAY_ROWS] = {0x00, 0x20, 0x10, 0x30};
+
+/**
+ * @brief Decodifica una transferencia como lo haría el controlador.
+ */
+void display_port_start(const uint8_t* data, size_t len) {
+    size_t i = 0;
+    while (i < len) {
+        if ((data[i] & 0xF8) != 0xF8) {
+            fprintf(stderr, "byte de sincronía inválido: 0x%02X\n", data[i]);
+            break;
+        }
+        bool rs = data[i++] & 0x02;
+        while (i + 1 < len && (data[i] & 0xF8) != 0xF8) {
+            uint8_t b = (data[i] & 0xF0) | (data[i + 1] >> 4);
+            i += 2;
+            if (!rs) {
+                if (b & 0x80) {
+                    address = (b & 0x1F) * 2;
+                }
+            } else {
+                ddram[address] = (char)b;
+                address = (address + 1) % (int)sizeof(ddram);
+            }
+        }
+    }
+    update_bytes += len;
+    pending_done = true;
+}
+
+void display_port_init() {
+    memset(ddram, ' ', sizeof(ddram));
+}
+
+uint32_t display_port_lock() {
+    return 0;
+}
+
+void display_port_unlock(uint32_t state) {
+    (void)state;
+}
+
+/**
+ * @brief Completa las transferencias encadenadas, como haría la interrupción del DMA.
+ */
+static void drain(void) {
+    while (pending_done) {
+        pending_done = false;
+        display_port_done();
+    }
+}
+
+/**
+ * @brief Dibuja el panel a partir de la memoria de texto.
+ */
+static void render(FILE* out) {
+    fprintf(out, "+");
+    for (int c = 0; c < DISPLAY_COLS; c++) {
+        fputc('-', out);
+    }
+    fprintf(out, "+\n");
+    for (int r = 0; r < DISPLAY_ROWS; r++) {
+        fprintf(out, "|%.*s|\n", DISPLAY_COLS, &ddram[row_start[r]]);
+    }
+    fprintf(out, "+");
+    for (int c = 0; c < DISPLAY_COLS; c++) {
+        fputc('-', out);
+    }
+    fprintf(out, "+\n");
+}
+
+/**
+ * @brief Quita el fin de línea y reemplaza las secuencias `\n` escritas por saltos reales.
+ */
+static size_t unescape(char* s) {
+    size_t r = 0, w = 0;
+    while (s[r] && s[r] != '\n') {
+        if (s[r] == '\\' && s[r + 1] == 'n') {
+            s[w++] = '\n';
+            r += 2;
+        } else {
+            s[w++] = s[r++];
+        }
+    }
+    s[w] = '\0';
+    return w;
+}
+
+/**
+ * @brief Muestra cada texto del catálogo en un panel limpio.
+ * 
+ * @return Cantidad de textos que partieron una palabra o no cupieron.
+ */
+static int check_catalog(FILE* out) {
+    static const char* const lang_names[] = {"es", "en"};
+    int bad = 0;
+    for (size_t i = 0; i < sizeof(catalog) / sizeof(catalog[0]); i++) {
+        for (int lang = 0; lang < 2; lang++) {
+            char text[LINE_MAX_LEN];
+            int n = snprintf(text, sizeof(text), "%s%s%s", catalog[i].lcd[lang][0],
+                             catalog[i].field ? CATALOG_FIELD : "", catalog[i].lcd[lang][1]);
+            display_clear();
+            drain();
+            update_bytes = 0;
+            bool clean = display_show(catalog[i].mode, text, (size_t)n);
+            drain();
+            fprintf(out, "%s %s: %lu bytes%s\n", catalog[i].name, lang_names[lang], update_bytes,
+                    clean ? "" : " NO CABE");
+            render(out);
+            bad += !clean;
+        }
+    }
+    fprintf(out, "textos=%zu no_caben=%d\n", 2 * sizeof(catalog) / sizeof(catalog[0]), bad);
+    return bad;
+}
+
+int main(int argc, char** argv) {
+    FILE* out = stdout;
+    if (argc == 2 && strcmp(argv[1], "--catalog") == 0) {
+        display_init();
+        return check_catalog(out) ? 1 : 0;
+    } else if (argc == 3 && strcmp(argv[1], "-o") == 0) {
+        out = fopen(argv[2], "w");
+        if (!out) {
+            perror(argv[2]);
+            return 1;
+        }
+    } else if (argc != 1) {
+        fprintf(stderr, "uso: %s [-o archivo] < mensajes | --catalog\n", argv[0]);
+        return 2;
+    }
+
+    display_init();
+
+    char line[LINE_MAX_LEN];
+    unsigned long messages = 0;
+    while (fgets(line, sizeof(line), stdin)) {
+        size_t len = unescape(line);
+        update_bytes = 0;
+        if (line[0] == '=' || line[0] == '+') {
+            display_show(line[0] == '=' ? DISPLAY_SCREEN : DISPLAY_BELOW, line + 1, len - 1);
+        } else {
+            display_write(line, len);
+        }
+        drain();
+        messages++;
+        fprintf(out, "mensaje %lu: %lu bytes\n", messages, update_bytes);
+        render(out);
+    }
+
+    DisplayStats stats;
+    display_get_stats(&stats);
+    unsigned long full = (unsigned long)DISPLAY_ROWS * DISPLAY_TX_MAX;
+    fprintf(out, "actualizaciones=%lu bytes=%lu max=%lu promedio=%.1f redibujo_completo=%lu\n",
+            (unsigned long)stats.updates, (unsigned long)stats.bytes_total,
+            (unsigned long)stats.max_update_bytes,
+            stats.updates ? (double)stats.bytes_total / stats.updates : 0.0, full);
+
+    for (int r = 0; r < DISPLAY_ROWS; r++) {
+        if (memcmp(display_row(r), &ddram[row_start[r]], DISPLAY_COLS) != 0) {
+            fprintf(stderr, "la fila %d del panel no coincide con el búfer de imagen\n", r);
+            return 1;
+        }
+    }
+    if (out != stdout) {
+        fclose(out);
+    }
+    return 0;
+}
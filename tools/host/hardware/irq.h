@@ -0,0 +1,10 @@
+/**
+ * @file irq.h
+ * @brief Sustituto vacío de `hardware/irq.h` para el anfitrión.
+ */
+#ifndef HOST_HARDWARE_IRQ_H
+#define HOST_HARDWARE_IRQ_H
+
+#include "pico/stdlib.h"
+
+#endif // HOST_HARDWARE_IRQ_H
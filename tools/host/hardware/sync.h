@@ -0,0 +1,19 @@
+/**
+ * @file sync.h
+ * @brief Sustituto de `hardware/sync.h` para el anfitrión: las interrupciones simuladas nunca
+ * interrumpen al código, por lo que las secciones críticas no hacen nada.
+ */
+#ifndef HOST_HARDWARE_SYNC_H
+#define HOST_HARDWARE_SYNC_H
+
+#include <stdint.h>
+
+static inline uint32_t save_and_disable_interrupts(void) {
+    return 0;
+}
+
+static inline void restore_interrupts(uint32_t state) {
+    (void)state;
+}
+
+#endif // HOST_HARDWARE_SYNC_H
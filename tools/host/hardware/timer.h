@@ -0,0 +1,16 @@
+/**
+ * @file timer.h
+ * @brief Sustituto mínimo de `hardware/timer.h` para el anfitrión.
+ */
+#ifndef HOST_HARDWARE_TIMER_H
+#define HOST_HARDWARE_TIMER_H
+
+#include "pico/stdlib.h"
+
+typedef void (*hardware_alarm_callback_t)(uint alarm_num);
+
+void hardware_alarm_claim(uint alarm_num);
+void hardware_alarm_set_callback(uint alarm_num, hardware_alarm_callback_t callback);
+bool hardware_alarm_set_target(uint alarm_num, absolute_time_t t);
+
+#endif // HOST_HARDWARE_TIMER_H
@@ -0,0 +1,24 @@
+/**
+ * @file watchdog.h
+ * @brief Sustituto mínimo de `hardware/watchdog.h` para el anfitrión; los registros scratch y el
+ * motivo del arranque los implementa la herramienta que los use.
+ */
+#ifndef HOST_HARDWARE_WATCHDOG_H
+#define HOST_HARDWARE_WATCHDOG_H
+
+#include "pico/stdlib.h"
+
+typedef struct {
+    volatile uint32_t scratch[8];
+} host_watchdog_hw_t;
+
+extern host_watchdog_hw_t host_watchdog;
+#define watchdog_hw (&host_watchdog)
+
+bool watchdog_caused_reboot(void);
+void watchdog_enable(uint32_t delay_ms, bool pause_on_debug);
+
+static inline void watchdog_update(void) {
+}
+
+#endif // HOST_HARDWARE_WATCHDOG_H
@@ -0,0 +1,44 @@
+/**
+ * @file stdlib.h
+ * @brief Sustituto mínimo de `pico/stdlib.h` para compilar el firmware en el anfitrión.
+ * 
+ * Solo declara lo que usan los módulos incluidos en `tools/irq_replay.c`; las funciones las
+ * implementa el reproductor sobre su reloj virtual (o cada herramienta de `tools/` que lo use).
+ */
+#ifndef HOST_PICO_STDLIB_H
+#define HOST_PICO_STDLIB_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef unsigned int uint;
+typedef uint64_t absolute_time_t;
+
+#define count_of(a) (sizeof(a) / sizeof((a)[0]))
+#define __uninitialized_ram(group) group
+#define __not_in_flash_func(f) f
+#ifndef __compiler_memory_barrier
+#define __compiler_memory_barrier() __asm__ volatile("" ::: "memory")   // `tools/txn_fault.c` lo redefine
+#endif
+
+absolute_time_t get_absolute_time(void);
+int64_t absolute_time_diff_us(absolute_time_t from, absolute_time_t to);
+absolute_time_t make_timeout_time_ms(uint32_t ms);
+bool time_reached(absolute_time_t t);
+uint32_t time_us_32(void);
+uint64_t time_us_64(void);
+void sleep_ms(uint32_t ms);
+void sleep_us(uint64_t us);
+void sleep_until(absolute_time_t t);
+
+static inline uint32_t to_ms_since_boot(absolute_time_t t) {
+    return (uint32_t)(t / 1000);
+}
+
+#define PICO_ERROR_TIMEOUT (-1)
+int getchar_timeout_us(uint32_t timeout_us);
+
+#include "hardware/gpio.h"
+
+#endif // HOST_PICO_STDLIB_H
@@ -0,0 +1,589 @@
+/**
+ * @file irq_replay.c
+ * @brief Reproductor del registro de interrupciones sobre el firmware compilado para el anfitrión.
+ * 
+ * Carga un registro exportado con `irqlog bin` y ejecuta el bucle principal (`main_loop_step()`,
+ * el mismo que llama `main.c`) con un reloj virtual: las esperas (`sleep_ms`, `sleep_until`) avanzan el reloj y entregan, en su instante
+ * grabado, los disparos de la alarma de escaneo y los flancos de columna a `timer_callback()` y
+ * `gpio_callback()`. El código no consume tiempo virtual, por lo que la reproducción es
+ * determinista (la salida es idéntica en cada ejecución) y mucho más rápida que el tiempo real.
+ * 
+ * Para cada tecla procesada informa el instante del flanco, el instante en que el bucle principal
+ * la consumió y la latencia entre ambos; si la tecla entregó un billete, también la latencia hasta
+ * el encendido del motor (tecla a efectivo). `--trace` los guarda en CSV y `--diff` compara las
+ * trazas de dos versiones del firmware. También cuenta las divergencias entre la fila grabada en cada
+ * interrupción y la que calcula el firmware reproducido.
+ * 
+ * Se reproduce con las cuentas de fábrica, sin cuentas aprovisionadas y con el diario sobre una
+ * flash borrada en RAM; un registro grabado tras restaurar una sesión parte de otro estado y se
+ * advierte. Un registro que empieza en una instantánea de reposo (el circular ya sobrescribió el
+ * arranque) arranca en frío y luego fija la fila de escaneo y el antirrebote de la instantánea.
+ * 
+ * Compilación: cc -O2 -Itools/host -I. -o irq_replay tools/irq_replay.c main_loop.c tcl.c \
+ *                 flow.c keybuf.c messages.c metrics.c pwm.c transaction.c s_luminosa.c deferred.c \
+ *                 display.c irqlog.c recovery.c journal.c
+ * Uso:         irq_replay registro.bin [--trace traza.csv] > salida.txt
+ *              irq_replay --diff traza_a.csv traza_b.csv
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "main.h"
+#include "main_loop.h"
+#include "tcl.h"
+#include "s_luminosa.h"
+#include "recovery.h"
+#include "messages.h"
+#include "provision.h"
+#include "flow.h"
+#include "deferred.h"
+#include "display.h"
+#include "irqlog.h"
+#include "journal.h"
+#include "memstat.h"
+#include "usb_cmd.h"
+#include "hardware/flash.h"
+#include "hardware/watchdog.h"
+
+#define REPLAY_TAIL_MS 1000
+#define TRACE_LINE_MAX 128
+
+/**
+ * @brief Tecla procesada por el bucle principal.
+ */
+typedef struct {
+    char key;
+    uint64_t edge_us;       /**< Flanco, desde el inicio de la grabación */
+    uint64_t consumed_us;   /**< Consumo por el bucle principal, desde el inicio de la grabación */
+    int64_t cash_us;        /**< Latencia de la tecla al encendido del motor (-1 si no entregó) */
+    int state;              /**< Estado del sistema tras procesarla */
+} TraceEntry;
+
+// --- Reloj virtual y registro ---
+
+static uint64_t now_us = 0;
+static uint64_t start_us = 0;
+static uint32_t period_us = 0;
+static uint32_t* words = NULL;
+static uint32_t word_count = 0;
+static uint32_t cursor = 0;
+static uint32_t run_left = 0;
+static uint64_t event_clock = 0;
+
+static uint32_t col_levels = 0;
+static gpio_irq_callback_t gpio_irq = NULL;
+static hardware_alarm_callback_t alarm_irq = NULL;
+static bool display_pending = false;
+static bool motor_on = false;
+static uint64_t motor_on_us = 0;
+
+static unsigned long edges = 0;
+static unsigned long alarms = 0;
+static unsigned long row_divergences = 0;
+
+/**
+ * @brief Instante del próximo evento grabado.
+ * 
+ * @return false si no quedan eventos.
+ */
+static bool next_event(uint64_t* at) {
+    if (run_left) {
+        *at = event_clock + period_us;
+        return true;
+    }
+    while (cursor < word_count && IRQLOG_TYPE(words[cursor]) == IRQLOG_TIME) {
+        event_clock += IRQLOG_DELTA(words[cursor++]);
+    }
+    if (cursor == word_count) {
+        return false;
+    }
+    *at = event_clock + IRQLOG_DELTA(words[cursor]);
+    return true;
+}
+
+/**
+ * @brief Fija el nivel de las columnas según los bits grabados (orden de `COL_PINS`).
+ */
+static void set_columns(uint8_t levels) {
+    col_levels = 0;
+    for (int col = 0; col < 4; col++) {
+        if (levels & (1u << col)) {
+            col_levels |= 1u << COL_PINS[col];
+        }
+    }
+}
+
+/**
+ * @brief Compara la fila grabada con la del firmware reproducido.
+ */
+static void check_row(uint8_t recorded) {
+    if (recorded != current_row) {
+        row_divergences++;
+    }
+}
+
+/**
+ * @brief Entrega el próximo evento grabado a la interrupción que corresponde.
+ */
+static void dispatch_event(void) {
+    if (run_left) {
+        event_clock += period_us;
+        run_left--;
+        set_columns(IRQLOG_COLS_IDLE);
+        alarms++;
+        alarm_irq(0);
+        return;
+    }
+
+    uint32_t w = words[cursor++];
+    uint32_t data = IRQLOG_DATA(w);
+    event_clock += IRQLOG_DELTA(w);
+
+    switch (IRQLOG_TYPE(w)) {
+    case IRQLOG_KEY_EDGE:
+        check_row((data >> 5) & 0x03);
+        col_levels &= ~(1u << (data & 0x1F));
+        edges++;
+        gpio_irq(data & 0x1F, GPIO_IRQ_EDGE_FALL);
+        break;
+    case IRQLOG_ALARM:
+        check_row((data >> 4) & 0x03);
+        set_columns(data & 0x0F);
+        alarms++;
+        alarm_irq(0);
+        break;
+    case IRQLOG_ALARM_RUN:
+        set_columns(IRQLOG_COLS_IDLE);
+        run_left = data - 1;
+        alarms++;
+        alarm_irq(0);
+        break;
+    default:
+        break;
+    }
+}
+
+/**
+ * @brief Avanza el reloj virtual hasta `t`, entregando las interrupciones que ocurren antes.
+ */
+static void advance_to(uint64_t t) {
+    uint64_t at;
+    while (display_pending) {
+        display_pending = false;
+        display_port_done();
+    }
+    while (next_event(&at) && at <= t) {
+        if (at > now_us) {
+            now_us = at;
+        }
+        dispatch_event();
+    }
+    if (t > now_us) {
+        now_us = t;
+    }
+}
+
+// --- SDK sobre el reloj virtual ---
+
+absolute_time_t get_absolute_time(void) {
+    return now_us;
+}
+
+int64_t absolute_time_diff_us(absolute_time_t from, absolute_time_t to) {
+    return (int64_t)(to - from);
+}
+
+absolute_time_t make_timeout_time_ms(uint32_t ms) {
+    return now_us + ms * 1000ull;
+}
+
+bool time_reached(absolute_time_t t) {
+    return now_us >= t;
+}
+
+uint32_t time_us_32(void) {
+    return (uint32_t)now_us;
+}
+
+uint64_t time_us_64(void) {
+    return now_us;
+}
+
+void sleep_ms(uint32_t ms) {
+    advance_to(now_us + ms * 1000ull);
+}
+
+void sleep_us(uint64_t us) {
+    advance_to(now_us + us);
+}
+
+void sleep_until(absolute_time_t t) {
+    advance_to(t);
+}
+
+void gpio_init(uint gpio) {
+    (void)gpio;
+}
+
+void gpio_set_dir(uint gpio, bool out) {
+    (void)gpio;
+    (void)out;
+}
+
+void gpio_put(uint gpio, bool value) {
+    for (int i = 0; i < NUM_DENOMINATIONS && value; i++) {
+        if (denominations[i].pinselect == (int)gpio) {
+            motor_on = true;
+            motor_on_us = now_us;
+        }
+    }
+}
+
+void gpio_pull_up(uint gpio) {
+    (void)gpio;
+}
+
+uint32_t gpio_get_all(void) {
+    return col_levels;
+}
+
+void gpio_set_irq_enabled_with_callback(uint gpio, uint32_t events, bool enabled, gpio_irq_callback_t callback) {
+    (void)gpio;
+    (void)events;
+    (void)enabled;
+    gpio_irq = callback;
+}
+
+void hardware_alarm_claim(uint alarm_num) {
+    (void)alarm_num;
+}
+
+void hardware_alarm_set_callback(uint alarm_num, hardware_alarm_callback_t callback) {
+    (void)alarm_num;
+    alarm_irq = callback;
+}
+
+bool hardware_alarm_set_target(uint alarm_num, absolute_time_t t) {
+    (void)alarm_num;
+    (void)t;
+    return false;      // los disparos salen del registro, no del objetivo programado
+}
+
+host_watchdog_hw_t host_watchdog;
+
+bool watchdog_caused_reboot(void) {
+    return false;      // la reproducción siempre arranca en frío
+}
+
+void watchdog_enable(uint32_t delay_ms, bool pause_on_debug) {
+    (void)delay_ms;
+    (void)pause_on_debug;
+}
+
+uint8_t host_flash[PICO_FLASH_SIZE_BYTES];
+
+void flash_range_erase(uint32_t flash_offs, size_t count) {
+    memset(host_flash + flash_offs, 0xFF, count);
+}
+
+void flash_range_program(uint32_t flash_offs, const uint8_t* data, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        host_flash[flash_offs + i] &= data[i];
+    }
+}
+
+// --- Subsistemas sin hardware en el anfitrión ---
+
+void provision_init(void) {
+}
+
+uint32_t provision_count(void) {
+    return 0;
+}
+
+const ProvisionRecord* provision_lookup(uint32_t id) {
+    (void)id;
+    return NULL;
+}
+
+bool provision_any_in_range(uint32_t min_id, uint32_t max_id) {
+    (void)min_id;
+    (void)max_id;
+    return false;
+}
+
+void provision_to_user(const ProvisionRecord* rec, User* user) {
+    (void)rec;
+    (void)user;
+}
+
+void usb_cmd_poll(void) {
+    // sin comandos de servicio: el registro no graba la entrada USB
+}
+
+void memstat_isr_sample(MemstatIsr isr) {
+    (void)isr;
+}
+
+void usb_cmd_write_binary(const void* data, size_t len) {
+    (void)data;
+    (void)len;
+}
+
+void display_port_init(void) {
+}
+
+void display_port_start(const uint8_t* data, size_t len) {
+    (void)data;
+    (void)len;
+    display_pending = true;
+}
+
+uint32_t display_port_lock(void) {
+    return 0;
+}
+
+void display_port_unlock(uint32_t state) {
+    (void)state;
+}
+
+// --- Registro y trazas ---
+
+static uint32_t fnv1a(uint32_t hash, const void* data, size_t len) {
+    const uint8_t* bytes = (const uint8_t*)data;
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+static bool load_log(const char* path, IrqLogHeader* header) {
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        return false;
+    }
+    bool ok = fread(header, sizeof(*header), 1, f) == 1 && memcmp(header->magic, "IR", 2) == 0 &&
+              header->version == IRQLOG_FORMAT_VERSION;
+    if (!ok) {
+        fprintf(stderr, "%s: cabecera inválida o versión no soportada\n", path);
+        fclose(f);
+        return false;
+    }
+
+    uint32_t hash;
+    words = malloc((header->count ? header->count : 1) * sizeof(uint32_t));
+    ok = words && fread(words, sizeof(uint32_t), header->count, f) == header->count &&
+         fread(&hash, sizeof(hash), 1, f) == 1;
+    fclose(f);
+    if (!ok) {
+        fprintf(stderr, "%s: registro truncado\n", path);
+        return false;
+    }
+    uint32_t expected = fnv1a(2166136261u, header, sizeof(*header));
+    expected = fnv1a(expected, words, header->count * sizeof(uint32_t));
+    if (hash != expected) {
+        fprintf(stderr, "%s: suma de verificación incorrecta\n", path);
+        return false;
+    }
+    word_count = header->count;
+    return true;
+}
+
+static size_t read_trace(const char* path, TraceEntry** out) {
+    FILE* f = fopen(path, "r");
+    if (!f) {
+        perror(path);
+        return 0;
+    }
+    size_t n = 0, cap = 64;
+    TraceEntry* entries = malloc(cap * sizeof(*entries));
+    char line[TRACE_LINE_MAX];
+    while (entries && fgets(line, sizeof(line), f)) {
+        TraceEntry e;
+        unsigned long long edge, consumed;
+        long long cash;
+        if (sscanf(line, "%c,%llu,%llu,%*u,%lld,%d", &e.key, &edge, &consumed, &cash, &e.state) != 5) {
+            continue;     // cabecera
+        }
+        e.edge_us = edge;
+        e.consumed_us = consumed;
+        e.cash_us = cash;
+        if (n == cap) {
+            cap *= 2;
+            entries = realloc(entries, cap * sizeof(*entries));
+        }
+        entries[n++] = e;
+    }
+    fclose(f);
+    *out = entries;
+    return n;
+}
+
+/**
+ * @brief Compara dos trazas tecla a tecla e informa las diferencias de tiempo.
+ */
+static int diff_traces(const char* path_a, const char* path_b) {
+    TraceEntry* a = NULL;
+    TraceEntry* b = NULL;
+    size_t na = read_trace(path_a, &a);
+    size_t nb = read_trace(path_b, &b);
+    size_t n = na < nb ? na : nb;
+    unsigned long changed = 0, state_changes = 0, cash_keys = 0;
+    int64_t max_delta = 0;
+    int64_t sum_delta = 0;
+    int64_t sum_cash_delta = 0;
+
+    printf("tecla,flanco_us,consumo_a_us,consumo_b_us,delta_us,efectivo_a_us,efectivo_b_us\n");
+    for (size_t i = 0; i < n; i++) {
+        if (a[i].key != b[i].key || a[i].edge_us != b[i].edge_us) {
+            fprintf(stderr, "las trazas divergen en la tecla %zu\n", i);
+            n = i;
+            break;
+        }
+        int64_t delta = (int64_t)b[i].consumed_us - (int64_t)a[i].consumed_us;
+        sum_delta += delta;
+        if (llabs(delta) > llabs(max_delta)) {
+            max_delta = delta;
+        }
+        if (a[i].cash_us >= 0 && b[i].cash_us >= 0) {
+            cash_keys++;
+            sum_cash_delta += b[i].cash_us - a[i].cash_us;
+        }
+        if (delta || a[i].cash_us != b[i].cash_us) {
+            changed++;
+            printf("%c,%llu,%llu,%llu,%lld,%lld,%lld\n", a[i].key, (unsigned long long)a[i].edge_us,
+                   (unsigned long long)a[i].consumed_us, (unsigned long long)b[i].consumed_us,
+                   (long long)delta, (long long)a[i].cash_us, (long long)b[i].cash_us);
+        }
+        if (a[i].state != b[i].state) {
+            state_changes++;
+        }
+    }
+    fprintf(stderr, "teclas=%zu/%zu con_delta=%lu delta_medio_us=%.1f delta_max_us=%lld estados_distintos=%lu\n",
+            n, na > nb ? na : nb, changed, n ? (double)sum_delta / n : 0.0, (long long)max_delta,
+            state_changes);
+    fprintf(stderr, "entregas=%lu delta_efectivo_medio_us=%.1f\n", cash_keys,
+            cash_keys ? (double)sum_cash_delta / cash_keys : 0.0);
+    free(a);
+    free(b);
+    return (changed || state_changes || na != nb) ? 1 : 0;
+}
+
+int main(int argc, char** argv) {
+    if (argc == 4 && strcmp(argv[1], "--diff") == 0) {
+        return diff_traces(argv[2], argv[3]);
+    }
+    const char* trace_path = NULL;
+    if (argc == 4 && strcmp(argv[2], "--trace") == 0) {
+        trace_path = argv[3];
+    } else if (argc != 2) {
+        fprintf(stderr, "uso: %s registro.bin [--trace traza.csv]\n"
+                        "     %s --diff traza_a.csv traza_b.csv\n", argv[0], argv[0]);
+        return 2;
+    }
+
+    IrqLogHeader header;
+    if (!load_log(argv[1], &header)) {
+        return 1;
+    }
+    if (header.flags & IRQLOG_FLAG_RESUMED) {
+        fprintf(stderr, "aviso: la grabación empezó con una sesión restaurada; se reproduce desde un arranque en frío\n");
+    }
+    if (header.flags & IRQLOG_FLAG_SNAPSHOT) {
+        fprintf(stderr, "aviso: el registro empieza en una instantánea de reposo; los saldos son los de fábrica\n");
+    }
+    FILE* trace = trace_path ? fopen(trace_path, "w") : NULL;
+    if (trace_path && !trace) {
+        perror(trace_path);
+        return 1;
+    }
+    if (trace) {
+        fprintf(trace, "tecla,flanco_us,consumo_us,latencia_us,efectivo_us,estado\n");
+    }
+
+    clock_t wall_start = clock();
+    start_us = header.start_us;
+    period_us = header.period_us;
+    now_us = start_us;
+    event_clock = start_us;
+
+    // Arranque en frío en el mismo orden que main.c
+    memset(host_flash, 0xFF, sizeof(host_flash));
+    inicialization();
+    display_init();
+    journal_init();
+    recovery_init();
+    provision_init();
+    msg_send(MSG_BOOT);
+    led_on_gpio12_permanently();
+    irqlog_init(false);
+    init_keypad();
+    last_key_time = get_absolute_time();
+    session_init();
+    if (header.flags & IRQLOG_FLAG_SNAPSHOT) {
+        current_row = header.row;
+        last_key_time = header.last_key_us;
+    }
+
+    unsigned long keys = 0;
+    uint64_t latency_sum = 0, latency_max = 0;
+    unsigned long dispenses = 0;
+    uint64_t cash_sum = 0, cash_max = 0;
+    uint64_t at;
+    uint64_t stop_at = 0;
+    while (true) {
+        if (!next_event(&at)) {
+            if (!stop_at) {
+                stop_at = now_us + REPLAY_TAIL_MS * 1000ull;
+            } else if (now_us >= stop_at) {
+                break;
+            }
+        }
+
+        KeyEvent ev;
+        motor_on = false;
+        if (main_loop_step(&ev)) {
+            uint64_t latency = now_us - ev.pressed_at;
+            int64_t cash = motor_on ? (int64_t)(motor_on_us - ev.pressed_at) : -1;
+            latency_sum += latency;
+            if (latency > latency_max) {
+                latency_max = latency;
+            }
+            keys++;
+            if (motor_on) {
+                dispenses++;
+                cash_sum += (uint64_t)cash;
+                if ((uint64_t)cash > cash_max) {
+                    cash_max = (uint64_t)cash;
+                }
+            }
+            if (trace) {
+                fprintf(trace, "%c,%llu,%llu,%llu,%lld,%d\n", ev.key,
+                        (unsigned long long)(ev.pressed_at - start_us),
+                        (unsigned long long)(now_us - start_us), (unsigned long long)latency,
+                        (long long)cash, (int)current_state);
+            }
+        }
+        sleep_ms(MAIN_LOOP_PERIOD_MS);
+    }
+    fflush(stdout);
+
+    double wall_s = (double)(clock() - wall_start) / CLOCKS_PER_SEC;
+    double virtual_s = (now_us - start_us) / 1e6;
+    fprintf(stderr, "\npalabras=%lu alarmas=%lu flancos=%lu teclas=%lu divergencias_fila=%lu\n",
+            (unsigned long)word_count, alarms, edges, keys, row_divergences);
+    fprintf(stderr, "latencia_media_us=%.0f latencia_max_us=%llu\n",
+            keys ? (double)latency_sum / keys : 0.0, (unsigned long long)latency_max);
+    fprintf(stderr, "entregas=%lu efectivo_medio_us=%.0f efectivo_max_us=%llu\n", dispenses,
+            dispenses ? (double)cash_sum / dispenses : 0.0, (unsigned long long)cash_max);
+    fprintf(stderr, "virtual_s=%.3f real_s=%.3f aceleracion=%.0fx\n", virtual_s, wall_s,
+            wall_s > 0 ? virtual_s / wall_s : 0.0);
+
+    if (trace) {
+        fclose(trace);
+    }
+    free(words);
+    return row_divergences ? 1 : 0;
+}
@@ -0,0 +1,288 @@
+/**
+ * @file journal_decode.c
+ * @brief Decodificador del diario de eventos exportado por el terminal (herramienta para Linux).
+ * 
+ * Lee una exportación binaria (ver `journal.h`) de un archivo capturado o, si se indica un puerto
+ * USB CDC, la pide con `journal export` y la recibe. Extrae el contenido de las tramas "JF" y
+ * descarta lo que llega entre ellas (texto de la sesión) o con la suma de la trama incorrecta.
+ * Verifica la suma de verificación de la exportación, escribe los
+ * registros en CSV por la salida estándar y muestra por la salida de error un resumen para la
+ * conciliación: eventos por tipo, retiros y montos por denominación y por cuenta, y
+ * saltos en la secuencia (registros sobrescritos o perdidos).
+ * 
+ * Compilación: cc -O2 -Itools/host -I. -o journal_decode tools/journal_decode.c
+ * Uso:         journal_decode diario.bin > diario.csv
+ *              journal_decode /dev/ttyACM0 [desde [hasta]] > diario.csv
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include "journal.h"
+
+#define RESPONSE_TIMEOUT_S 60
+#define MAX_ACCOUNTS 4096
+#define MAX_DENOMINATIONS 256
+
+static const char* const event_names[JOURNAL_EVENT_COUNT] = {
+    "arranque", "inicio_sesion", "clave_incorrecta", "bloqueo", "id_inexistente",
+    "retiro", "consulta_saldo", "cambio_clave", "prueba", "retiro_recuperado",
+};
+
+/**
+ * @brief Totales de retiro de una cuenta o denominación.
+ */
+typedef struct {
+    uint32_t key;
+    unsigned long count;
+    long long amount;
+} Total;
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int open_port(const char* path) {
+    int fd = open(path, O_RDWR | O_NOCTTY);
+    if (fd < 0) {
+        perror(path);
+        return -1;
+    }
+    struct termios tio;
+    if (tcgetattr(fd, &tio) == 0) {
+        cfmakeraw(&tio);
+        tio.c_cc[VMIN] = 0;
+        tio.c_cc[VTIME] = 1;        // lecturas con espera de 100 ms
+        tcsetattr(fd, TCSANOW, &tio);
+    }
+    tcflush(fd, TCIOFLUSH);
+    return fd;
+}
+
+/**
+ * @brief Lee exactamente `len` bytes; en un puerto espera hasta `RESPONSE_TIMEOUT_S`.
+ */
+static int read_exact(int fd, void* buf, size_t len) {
+    uint8_t* p = (uint8_t*)buf;
+    double deadline = now_s() + RESPONSE_TIMEOUT_S;
+    while (len > 0) {
+        ssize_t n = read(fd, p, len);
+        if (n < 0 && errno != EINTR && errno != EAGAIN) {
+            perror("read");
+            return -1;
+        }
+        if (n == 0 && !isatty(fd)) {
+            return -1;              // fin de archivo
+        }
+        if (n > 0) {
+            p += n;
+            len -= (size_t)n;
+        } else if (now_s() > deadline) {
+            fprintf(stderr, "sin respuesta del dispositivo\n");
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static uint32_t fnv1a(uint32_t hash, const void* data, size_t len) {
+    const uint8_t* bytes = (const uint8_t*)data;
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * @brief Contenido de la última trama válida y cuánto de él ya se consumió.
+ */
+static uint8_t frame_data[JOURNAL_FRAME_MAX];
+static size_t frame_len = 0;
+static size_t frame_pos = 0;
+static unsigned long frames_dropped = 0;
+
+/**
+ * @brief Lee la próxima trama válida, descartando el texto que la precede y las tramas dañadas.
+ */
+static int next_frame(int fd) {
+    JournalFrame frame;
+    uint8_t* window = (uint8_t*)&frame;
+    memset(&frame, 0, sizeof(frame));
+    while (true) {
+        memmove(window, window + 1, sizeof(frame) - 1);
+        if (read_exact(fd, &window[sizeof(frame) - 1], 1) < 0) {
+            return -1;
+        }
+        if (frame.magic[0] != 'J' || frame.magic[1] != 'F' || frame.len == 0 || frame.len > JOURNAL_FRAME_MAX) {
+            continue;
+        }
+        if (read_exact(fd, frame_data, frame.len) < 0) {
+            return -1;
+        }
+        if (fnv1a(fnv1a(2166136261u, &frame.len, sizeof(frame.len)), frame_data, frame.len) == frame.check) {
+            frame_len = frame.len;
+            frame_pos = 0;
+            return 0;
+        }
+        frames_dropped++;
+        memset(&frame, 0, sizeof(frame));
+    }
+}
+
+/**
+ * @brief Lee exactamente `len` bytes del contenido de las tramas.
+ */
+static int read_payload(int fd, void* buf, size_t len) {
+    uint8_t* p = (uint8_t*)buf;
+    while (len > 0) {
+        if (frame_pos == frame_len && next_frame(fd) < 0) {
+            return -1;
+        }
+        size_t n = frame_len - frame_pos < len ? frame_len - frame_pos : len;
+        memcpy(p, frame_data + frame_pos, n);
+        frame_pos += n;
+        p += n;
+        len -= n;
+    }
+    return 0;
+}
+
+/**
+ * @brief Lee la cabecera de la exportación, que va en la primera trama.
+ */
+static int read_header(int fd, JournalExportHeader* header) {
+    if (read_payload(fd, header, sizeof(*header)) < 0) {
+        return -1;
+    }
+    return header->magic[0] == 'J' && header->magic[1] == 'R' && header->version == JOURNAL_FORMAT_VERSION &&
+                   header->record_size == sizeof(JournalRecord)
+               ? 0
+               : -1;
+}
+
+/**
+ * @brief Suma un retiro al total de `key`, agregándolo si no existe.
+ */
+static void add_total(Total* totals, size_t* n, size_t max, uint32_t key, int32_t amount) {
+    for (size_t i = 0; i < *n; i++) {
+        if (totals[i].key == key) {
+            totals[i].count++;
+            totals[i].amount += amount;
+            return;
+        }
+    }
+    if (*n < max) {
+        totals[*n] = (Total){key, 1, amount};
+        (*n)++;
+    }
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2 || argc > 4) {
+        fprintf(stderr, "uso: %s <exportación.bin | puerto> [desde [hasta]]\n", argv[0]);
+        return 2;
+    }
+
+    struct stat st;
+    bool is_port = stat(argv[1], &st) == 0 && S_ISCHR(st.st_mode);
+    int fd = is_port ? open_port(argv[1]) : open(argv[1], O_RDONLY);
+    if (fd < 0) {
+        perror(argv[1]);
+        return 1;
+    }
+    double start = now_s();
+    if (is_port) {
+        char cmd[64];
+        snprintf(cmd, sizeof(cmd), "journal export %s %s\n", argc > 2 ? argv[2] : "0",
+                 argc > 3 ? argv[3] : "0");
+        if (write(fd, cmd, strlen(cmd)) < 0) {
+            perror("write");
+            return 1;
+        }
+    }
+
+    JournalExportHeader header;
+    if (read_header(fd, &header) < 0) {
+        fprintf(stderr, "no se encontró la cabecera del diario\n");
+        return 1;
+    }
+
+    static Total by_account[MAX_ACCOUNTS];
+    static Total by_denomination[MAX_DENOMINATIONS];
+    size_t accounts = 0, denominations = 0;
+    unsigned long per_event[JOURNAL_EVENT_COUNT] = {0};
+    unsigned long records = 0, gaps = 0, missing = 0;
+    uint32_t last_seq = 0;
+    uint32_t hash = 2166136261u;
+    JournalRecord rec;
+
+    printf("secuencia,tiempo_ms,cuenta,evento,detalle,valor\n");
+    while (true) {
+        if (read_payload(fd, &rec, sizeof(rec)) < 0) {
+            fprintf(stderr, "exportación truncada tras %lu registros\n", records);
+            return 1;
+        }
+        if (rec.seq == JOURNAL_SEQ_END) {
+            break;
+        }
+        hash = fnv1a(hash, &rec, sizeof(rec));
+        records++;
+
+        uint32_t event = JOURNAL_EVENT(rec.info);
+        printf("%lu,%lu,%06lu,%s,%lu,%ld\n", (unsigned long)rec.seq, (unsigned long)rec.time_ms,
+               (unsigned long)JOURNAL_ACCOUNT(rec.info),
+               event < JOURNAL_EVENT_COUNT ? event_names[event] : "?",
+               (unsigned long)JOURNAL_DETAIL(rec.info), (long)rec.value);
+
+        if (event < JOURNAL_EVENT_COUNT) {
+            per_event[event]++;
+        }
+        if (event == JOURNAL_DISPENSE || event == JOURNAL_DISPENSE_RECOVERED) {
+            add_total(by_account, &accounts, MAX_ACCOUNTS, JOURNAL_ACCOUNT(rec.info), rec.value);
+            add_total(by_denomination, &denominations, MAX_DENOMINATIONS, JOURNAL_DETAIL(rec.info), rec.value);
+        }
+        if (last_seq && rec.seq != last_seq + 1) {
+            gaps++;
+            if (rec.seq > last_seq) {
+                missing += rec.seq - last_seq - 1;
+            }
+        }
+        last_seq = rec.seq;
+    }
+
+    uint32_t device_hash;
+    if (read_payload(fd, &device_hash, sizeof(device_hash)) < 0) {
+        fprintf(stderr, "falta la suma de verificación\n");
+        return 1;
+    }
+    double elapsed = now_s() - start;
+    close(fd);
+
+    fprintf(stderr, "\nregistros=%lu (dispositivo=%ld) rango=%lu..%lu suma=%s\n", records, (long)rec.value,
+            (unsigned long)header.from_seq, (unsigned long)header.to_seq,
+            device_hash == hash && (uint32_t)rec.value == records ? "ok" : "INCORRECTA");
+    for (int i = 0; i < JOURNAL_EVENT_COUNT; i++) {
+        fprintf(stderr, "%s=%lu\n", event_names[i], per_event[i]);
+    }
+    for (size_t i = 0; i < denominations; i++) {
+        fprintf(stderr, "denominacion %lu: retiros=%lu monto=%lld\n", (unsigned long)by_denomination[i].key,
+                by_denomination[i].count, by_denomination[i].amount);
+    }
+    for (size_t i = 0; i < accounts; i++) {
+        fprintf(stderr, "cuenta %06lu: retiros=%lu monto=%lld\n", (unsigned long)by_account[i].key,
+                by_account[i].count, by_account[i].amount);
+    }
+    fprintf(stderr, "saltos_de_secuencia=%lu registros_faltantes=%lu tramas_descartadas=%lu\n", gaps, missing,
+            frames_dropped);
+    if (is_port) {
+        fprintf(stderr, "recepcion_s=%.2f registros_s=%.0f\n", elapsed, elapsed > 0 ? records / elapsed : 0.0);
+    }
+    return device_hash == hash && (uint32_t)rec.value == records ? 0 : 1;
+}
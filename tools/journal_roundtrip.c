@@ -0,0 +1,267 @@
+/**
+ * @file journal_roundtrip.c
+ * @brief Prueba de ida y vuelta del diario: exportación del firmware y decodificador (herramienta para Linux).
+ * 
+ * Compila `journal.c` sobre una imagen de flash en RAM y `tools/journal_decode.c` en el mismo
+ * programa. Registra eventos con secuencias de varias cifras y valores cuyos bytes incluyen 0x0A y
+ * 0x0D, exporta avanzando con `journal_poll()` mientras intercala texto como el que la sesión
+ * escribe por el mismo puerto, y decodifica la captura. Comprueba que:
+ * 
+ *  - el decodificador acepta la suma y la cantidad, y su CSV reproduce cada registro en orden;
+ *  - un rango parcial exporta solo las secuencias pedidas;
+ *  - una trama dañada se descarta y la exportación se informa incorrecta;
+ *  - `journal bench` se rechaza si sobrescribiría registros sin exportar y se acepta tras exportarlos.
+ * 
+ * Compilación: cc -O2 -Itools/host -I. -o journal_roundtrip tools/journal_roundtrip.c journal.c
+ * Uso:         journal_roundtrip
+ */
+#define main journal_decode_main
+#include "tools/journal_decode.c"
+#undef main
+
+#include "hardware/flash.h"
+#include "hardware/watchdog.h"
+#include "usb_cmd.h"
+
+#define RING_RECORDS (FLASH_JOURNAL_SIZE / FLASH_PAGE_SIZE * JOURNAL_RECORDS_PER_PAGE)
+#define LOGGED_MAX 256
+#define CAPTURE_PATH "journal_roundtrip.bin"
+#define CSV_PATH "journal_roundtrip.csv"
+#define SUMMARY_PATH "journal_roundtrip.txt"
+
+uint8_t host_flash[PICO_FLASH_SIZE_BYTES];
+
+static uint64_t now_us = 0;
+static FILE* capture = NULL;
+static unsigned long pages_programmed = 0;
+static unsigned long program_errors = 0;
+static int failures = 0;
+
+static JournalRecord logged[LOGGED_MAX];
+static size_t logged_count = 0;
+
+// --- Dependencias de journal.c ---
+
+absolute_time_t get_absolute_time(void) {
+    return now_us;
+}
+
+int64_t absolute_time_diff_us(absolute_time_t from, absolute_time_t to) {
+    return (int64_t)(to - from);
+}
+
+uint64_t time_us_64(void) {
+    return now_us;
+}
+
+bool watchdog_caused_reboot(void) {
+    return false;
+}
+
+void flash_range_erase(uint32_t flash_offs, size_t count) {
+    memset(host_flash + flash_offs, 0xFF, count);
+}
+
+void flash_range_program(uint32_t flash_offs, const uint8_t* data, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        if (host_flash[flash_offs + i] != 0xFF) {
+            program_errors++;
+        }
+        host_flash[flash_offs + i] &= data[i];
+    }
+    pages_programmed += count / FLASH_PAGE_SIZE;
+}
+
+void usb_cmd_write_binary(const void* data, size_t len) {
+    fwrite(data, 1, len, capture);
+}
+
+// --- Prueba ---
+
+static void check(bool ok, const char* what) {
+    if (!ok) {
+        printf("FALLO: %s\n", what);
+        failures++;
+    }
+}
+
+/**
+ * @brief Registra un evento y guarda lo que el diario debería exportar.
+ */
+static void log_event(JournalEvent event, uint32_t account, uint8_t detail, int32_t value) {
+    journal_log(event, account, detail, value);
+    if (logged_count < LOGGED_MAX) {
+        logged[logged_count] = (JournalRecord){
+            .seq = (uint32_t)logged_count + 2,          // la secuencia 1 es el arranque
+            .time_ms = (uint32_t)(now_us / 1000),
+            .info = JOURNAL_INFO(account, event, detail),
+            .value = value,
+        };
+        logged_count++;
+    }
+    now_us += 137000;
+    journal_poll(true);
+}
+
+/**
+ * @brief Exporta `[from, to]` a la captura, con texto de sesión entre las iteraciones del bucle.
+ */
+static void export_range(uint32_t from, uint32_t to) {
+    static const char* const session_text[] = {
+        "\r\nIngrese su ID (6 digitos):\r\n", "******\r\n", "JF: texto con la marca de trama\r\n",
+        "\r\n1. Retirar dinero\r\n2. Consultar saldo\r\n",
+    };
+    capture = fopen(CAPTURE_PATH, "wb");
+    fputs(session_text[0], capture);
+    journal_export_start(from, to);
+    for (uint32_t i = 0; i <= FLASH_JOURNAL_SIZE / FLASH_PAGE_SIZE / JOURNAL_EXPORT_PAGES_PER_POLL; i++) {
+        fputs(session_text[i % count_of(session_text)], capture);
+        journal_poll(false);
+    }
+    fclose(capture);
+}
+
+/**
+ * @brief Ejecuta el decodificador sobre la captura con su salida redirigida a archivos.
+ * 
+ * @return Código de salida del decodificador.
+ */
+static int decode(void) {
+    char* argv[] = {"journal_decode", CAPTURE_PATH, NULL};
+    frame_len = 0;
+    frame_pos = 0;
+    frames_dropped = 0;
+
+    fflush(stdout);
+    fflush(stderr);
+    int saved_out = dup(STDOUT_FILENO);
+    int saved_err = dup(STDERR_FILENO);
+    int csv = open(CSV_PATH, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    int summary = open(SUMMARY_PATH, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    dup2(csv, STDOUT_FILENO);
+    dup2(summary, STDERR_FILENO);
+    int rc = journal_decode_main(2, argv);
+    fflush(stdout);
+    fflush(stderr);
+    dup2(saved_out, STDOUT_FILENO);
+    dup2(saved_err, STDERR_FILENO);
+    close(csv);
+    close(summary);
+    close(saved_out);
+    close(saved_err);
+    return rc;
+}
+
+/**
+ * @brief Compara el CSV decodificado con los registros guardados de secuencia `[from, to]`.
+ */
+static void verify_csv(uint32_t from, uint32_t to) {
+    FILE* f = fopen(CSV_PATH, "r");
+    char line[128];
+    uint32_t expected = from;
+    if (f == NULL || fgets(line, sizeof(line), f) == NULL) {
+        check(false, "CSV sin cabecera");
+        return;
+    }
+    while (fgets(line, sizeof(line), f)) {
+        unsigned long seq, time_ms, account, detail;
+        long value;
+        char event[32];
+        if (sscanf(line, "%lu,%lu,%lu,%31[^,],%lu,%ld", &seq, &time_ms, &account, event, &detail, &value) != 6) {
+            check(false, "línea del CSV ilegible");
+            break;
+        }
+        if (seq != expected) {
+            check(false, "secuencia inesperada en el CSV");
+            break;
+        }
+        if (seq >= 2 && seq - 2 < logged_count) {
+            const JournalRecord* rec = &logged[seq - 2];
+            uint32_t ev = JOURNAL_EVENT(rec->info);
+            check(time_ms == rec->time_ms && account == JOURNAL_ACCOUNT(rec->info) &&
+                      strcmp(event, event_names[ev]) == 0 && detail == JOURNAL_DETAIL(rec->info) &&
+                      value == rec->value,
+                  "registro decodificado distinto del registrado");
+        }
+        expected++;
+    }
+    check(expected == to + 1, "faltan registros en el CSV");
+    fclose(f);
+}
+
+/**
+ * @brief Daña un byte del contenido de la segunda trama de la captura (el texto "JF" no cuenta).
+ */
+static void corrupt_capture(void) {
+    static uint8_t data[1 << 20];
+    FILE* f = fopen(CAPTURE_PATH, "rb");
+    size_t len = fread(data, 1, sizeof(data), f);
+    fclose(f);
+    int seen = 0;
+    for (size_t i = 0; i + sizeof(JournalFrame) < len; i++) {
+        JournalFrame frame;
+        memcpy(&frame, &data[i], sizeof(frame));
+        if (frame.magic[0] == 'J' && frame.magic[1] == 'F' && frame.len > 0 && frame.len <= JOURNAL_FRAME_MAX &&
+            ++seen == 2) {
+            data[i + sizeof(frame)] ^= 0x01;
+            break;
+        }
+    }
+    f = fopen(CAPTURE_PATH, "wb");
+    fwrite(data, 1, len, f);
+    fclose(f);
+}
+
+int main(void) {
+    memset(host_flash, 0xFF, sizeof(host_flash));
+    now_us = 5000000;
+    journal_init();
+
+    // Secuencias de varias cifras (la 10 es 0x0A) y valores con bytes 0x0A y 0x0D
+    for (int i = 0; i < 200; i++) {
+        JournalEvent event = (JournalEvent)(JOURNAL_LOGIN + i % (JOURNAL_BENCH - JOURNAL_LOGIN));
+        int32_t value = i % 3 == 0 ? 0x0A0D0A0D : i % 3 == 1 ? -(int32_t)(i * 10) : 0x0D0A;
+        log_event(event, 100000 + (uint32_t)i, (uint8_t)(i % 4), value);
+    }
+    uint32_t last = (uint32_t)logged_count + 1;
+
+    // Exportación completa
+    export_range(0, JOURNAL_SEQ_END - 1);
+    check(decode() == 0, "exportación completa rechazada por el decodificador");
+    check(frames_dropped == 0, "tramas descartadas sin daño");
+    verify_csv(1, last);
+
+    // Rango parcial
+    export_range(50, 120);
+    check(decode() == 0, "exportación parcial rechazada");
+    verify_csv(50, 120);
+
+    // Trama dañada
+    export_range(0, JOURNAL_SEQ_END - 1);
+    corrupt_capture();
+    check(decode() != 0, "exportación con una trama dañada aceptada");
+    check(frames_dropped == 1, "la trama dañada no se descartó");
+
+    // Registros sin exportar delante de la escritura: el bench no debe alcanzarlos
+    for (uint32_t i = 0; i < RING_RECORDS; i++) {
+        journal_log(JOURNAL_BALANCE, 200000, 0, (int32_t)i);
+        now_us += 1000;
+        journal_poll(true);
+    }
+    unsigned long before = pages_programmed;
+    journal_bench(JOURNAL_BENCH_MAX);
+    check(pages_programmed == before, "bench sobrescribió registros sin exportar");
+
+    export_range(0, JOURNAL_SEQ_END - 1);
+    check(decode() == 0, "exportación tras dar la vuelta rechazada");
+    before = pages_programmed;
+    journal_bench(JOURNAL_BENCH_MAX);
+    check(pages_programmed > before, "bench rechazado con todo exportado");
+
+    check(program_errors == 0, "programación sobre flash sin borrar");
+    remove(CAPTURE_PATH);
+    remove(CSV_PATH);
+    remove(SUMMARY_PATH);
+    printf("registros=%zu fallos=%d\n", logged_count + 1, failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,222 @@
+# Reparto de RAM y flash por módulo a partir del mapa del enlazador.
+#
+# Suma cada sección de entrada enlazada según el archivo objeto de origen: los módulos del proyecto
+# por nombre, las bibliotecas del SDK como sdk:<biblioteca> y las de la cadena de herramientas por
+# archivo .a. La flash incluye la imagen de carga de .data y de las secciones scratch; la RAM,
+# .data, .bss y las secciones sin inicializar. El montículo y las pilas reservadas se informan aparte.
+#
+# Uso: cmake -DMAP=pusuarios.elf.map [-DOUT=pusuarios.mem.txt] -P tools/mem_report.cmake
+
+if(NOT MAP)
+  message(FATAL_ERROR "uso: cmake -DMAP=<archivo.map> [-DOUT=<informe>] -P mem_report.cmake")
+endif()
+
+set(RAM_TOTAL 270336)   # 256 KB de SRAM principal y dos bancos scratch de 4 KB
+
+set(FLASH_SECTIONS .boot2 .text .rodata .ARM.extab .ARM.exidx .binary_info)
+set(LOADED_SECTIONS .data .scratch_x .scratch_y)
+set(RAM_SECTIONS .ram_vector_table .uninitialized_data .bss)
+
+# Grupo al que se atribuye un archivo objeto.
+function(object_group obj out)
+  if(section STREQUAL ".boot2")
+    set(group "boot2")
+  elseif(obj MATCHES "CMakeFiles/[^/]+\\.dir/([^/\\\\]+)\\.c(pp)?\\.obj$")
+    set(group "${CMAKE_MATCH_1}")
+  elseif(obj MATCHES "/lib/tinyusb/")
+    set(group "sdk:tinyusb")
+  elseif(obj MATCHES "/src/[^/]+/([^/]+)/")
+    set(group "sdk:${CMAKE_MATCH_1}")
+  elseif(obj MATCHES "([^/\\\\]+)\\.a\\(")
+    set(group "${CMAKE_MATCH_1}")
+  elseif(obj MATCHES "([^/\\\\]+)\\.o$")
+    set(group "${CMAKE_MATCH_1}")
+  elseif(obj STREQUAL "linker stubs")
+    set(group "(enlazador)")
+  else()
+    set(group "otros")
+  endif()
+  set(${out} "${group}" PARENT_SCOPE)
+endfunction()
+
+# Suma `bytes` al grupo según el tipo de la sección de salida en curso.
+macro(account group bytes)
+  if(${bytes} GREATER 0 AND kind)
+    string(MAKE_C_IDENTIFIER "${group}" id)
+    if(NOT DEFINED ram_${id})
+      list(APPEND groups "${group}")
+      set(ram_${id} 0)
+      set(flash_${id} 0)
+    endif()
+    if(kind STREQUAL "flash" OR kind STREQUAL "loaded")
+      math(EXPR flash_${id} "${flash_${id}} + ${bytes}")
+      math(EXPR flash_total "${flash_total} + ${bytes}")
+    endif()
+    if(kind STREQUAL "ram" OR kind STREQUAL "loaded")
+      math(EXPR ram_${id} "${ram_${id}} + ${bytes}")
+      math(EXPR ram_total "${ram_total} + ${bytes}")
+    endif()
+  endif()
+endmacro()
+
+# Registra una sección de entrada (dirección y tamaño en hexadecimal) y contabiliza la anterior.
+# Las cadenas fusionadas figuran con su tamaño previo a la fusión y se solapan con la siguiente
+# sección; por eso cada una cuenta como máximo hasta la dirección de la que le sigue.
+macro(input group addr size)
+  math(EXPR next_addr "0x${addr}")
+  if(NOT last_group STREQUAL "")
+    math(EXPR gap "${next_addr} - ${last_addr}")
+    if(gap GREATER_EQUAL 0 AND gap LESS last_size)
+      set(last_size ${gap})
+    endif()
+    account("${last_group}" ${last_size})
+  endif()
+  set(last_group "${group}")
+  set(last_addr ${next_addr})
+  math(EXPR last_size "0x${size}")
+endmacro()
+
+# Contabiliza la última sección de entrada de la sección de salida en curso.
+macro(input_flush)
+  if(NOT last_group STREQUAL "")
+    account("${last_group}" ${last_size})
+  endif()
+  set(last_group "")
+endmacro()
+
+# Tamaño de una sección de salida reservada (montículo, pilas).
+macro(reserve size)
+  math(EXPR bytes "0x${size}")
+  if(section STREQUAL ".heap")
+    set(heap ${bytes})
+  elseif(section STREQUAL ".stack_dummy")
+    set(stack0 ${bytes})
+  elseif(section STREQUAL ".stack1_dummy")
+    set(stack1 ${bytes})
+  endif()
+endmacro()
+
+# Rellena `value` con espacios a la izquierda hasta `width` caracteres.
+function(pad value width out)
+  string(LENGTH "${value}" len)
+  while(len LESS width)
+    set(value " ${value}")
+    math(EXPR len "${len} + 1")
+  endwhile()
+  set(${out} "${value}" PARENT_SCOPE)
+endfunction()
+
+file(STRINGS "${MAP}" lines
+     REGEX "^(Linker script and memory map|\\.| [^ ]| +0x[0-9a-fA-F]+ +0x[0-9a-fA-F]+)")
+
+set(groups "")
+set(flash_total 0)
+set(ram_total 0)
+set(heap 0)
+set(stack0 0)
+set(stack1 0)
+set(started FALSE)
+set(kind "")
+set(section "")
+set(pending "")
+set(want_size FALSE)
+set(last_group "")
+
+foreach(line IN LISTS lines)
+  if(NOT started)
+    if(line STREQUAL "Linker script and memory map")
+      set(started TRUE)
+    endif()
+    continue()
+  endif()
+
+  if(line MATCHES "^(\\.[^ ]+)( +0x[0-9a-fA-F]+ +0x([0-9a-fA-F]+))?")
+    # Sección de salida; el tamaño va en la misma línea o, si el nombre es largo, en la siguiente
+    input_flush()
+    set(section "${CMAKE_MATCH_1}")
+    set(size "${CMAKE_MATCH_3}")
+    set(pending "")
+    list(FIND FLASH_SECTIONS "${section}" in_flash)
+    list(FIND LOADED_SECTIONS "${section}" in_loaded)
+    list(FIND RAM_SECTIONS "${section}" in_ram)
+    if(NOT in_flash EQUAL -1)
+      set(kind "flash")
+    elseif(NOT in_loaded EQUAL -1)
+      set(kind "loaded")
+    elseif(NOT in_ram EQUAL -1)
+      set(kind "ram")
+    else()
+      set(kind "")
+    endif()
+    if(size STREQUAL "")
+      set(want_size TRUE)
+    else()
+      set(want_size FALSE)
+      reserve(${size})
+    endif()
+  elseif(line MATCHES "^ \\*fill\\* +0x([0-9a-fA-F]+) +0x([0-9a-fA-F]+)")
+    input("(relleno)" ${CMAKE_MATCH_1} ${CMAKE_MATCH_2})
+  elseif(line MATCHES "^ ([^ *][^ ]*) +0x([0-9a-fA-F]+) +0x([0-9a-fA-F]+) (.+)$")
+    set(addr "${CMAKE_MATCH_2}")
+    set(size "${CMAKE_MATCH_3}")
+    object_group("${CMAKE_MATCH_4}" group)
+    input("${group}" ${addr} ${size})
+    set(pending "")
+  elseif(line MATCHES "^ ([^ *][^ ]*)$")
+    set(pending "${CMAKE_MATCH_1}")   # sección de entrada con nombre largo: sigue en la próxima línea
+  elseif(line MATCHES "^ +0x([0-9a-fA-F]+) +0x([0-9a-fA-F]+)( (.+))?$")
+    set(addr "${CMAKE_MATCH_1}")
+    set(size "${CMAKE_MATCH_2}")
+    set(obj "${CMAKE_MATCH_4}")
+    if(want_size)
+      set(want_size FALSE)
+      reserve(${size})
+    elseif(NOT pending STREQUAL "" AND NOT obj STREQUAL "")
+      object_group("${obj}" group)
+      input("${group}" ${addr} ${size})
+    endif()
+    set(pending "")
+  endif()
+endforeach()
+input_flush()
+
+if(NOT started)
+  message(FATAL_ERROR "${MAP} no parece un mapa de enlace de GNU ld")
+endif()
+
+# Orden: más RAM primero, luego más flash
+set(rows "")
+foreach(group IN LISTS groups)
+  string(MAKE_C_IDENTIFIER "${group}" id)
+  math(EXPR key_ram "100000000 + ${ram_${id}}")
+  math(EXPR key_flash "100000000 + ${flash_${id}}")
+  list(APPEND rows "${key_ram}|${key_flash}|${group}")
+endforeach()
+list(SORT rows ORDER DESCENDING)
+
+set(report "Memoria por módulo (${MAP})\n\n")
+pad("modulo" 28 col)
+string(APPEND report "${col}      RAM     flash\n")
+foreach(row IN LISTS rows)
+  string(REPLACE "|" ";" fields "${row}")
+  list(GET fields 2 group)
+  string(MAKE_C_IDENTIFIER "${group}" id)
+  pad("${group}" 27 col)
+  pad("${ram_${id}}" 9 ram)
+  pad("${flash_${id}}" 9 flash)
+  string(APPEND report "${col} ${ram} ${flash}\n")
+endforeach()
+
+math(EXPR ram_used "${ram_total} + ${heap} + ${stack0} + ${stack1}")
+math(EXPR ram_free "${RAM_TOTAL} - ${ram_used}")
+pad("total" 28 col)
+pad("${ram_total}" 9 ram)
+pad("${flash_total}" 9 flash)
+string(APPEND report "\n${col} ${ram} ${flash}\n")
+string(APPEND report "montículo reservado ${heap}, pila núcleo 0 ${stack0}, pila núcleo 1 ${stack1}\n")
+string(APPEND report "RAM usada ${ram_used} de ${RAM_TOTAL}; sin asignar ${ram_free}\n")
+
+if(OUT)
+  file(WRITE "${OUT}" "${report}")
+endif()
+message("${report}")
@@ -0,0 +1,187 @@
+/**
+ * @file provision_bench.c
+ * @brief Prueba de rendimiento y corrección del aprovisionamiento del firmware (herramienta para Linux).
+ * 
+ * Compila `provision.c` sobre una imagen de flash en RAM y le entrega por `getchar_timeout_us()`
+ * el mismo CSV sintético que genera `provision_sender --generate`, sin USB de por medio. Mide el
+ * tiempo de análisis y escritura en el anfitrión, cuenta los borrados y programaciones de flash y
+ * estima con los tiempos típicos de la memoria del Pico (W25Q16JV) cuánto tardaría la escritura
+ * en el dispositivo, que es lo que limita la carga cuando el enlace USB no lo hace.
+ * 
+ * Además verifica que:
+ * 
+ *  - solo se programan páginas previamente borradas;
+ *  - tras la carga, cada cuenta se encuentra con búsqueda binaria y sus datos son correctos;
+ *  - una segunda carga usa el otro banco y, al reiniciar, se activa la generación más reciente;
+ *  - una carga interrumpida por un error deja activa la tabla anterior.
+ * 
+ * Compilación: cc -O2 -Itools/host -I. -o provision_bench tools/provision_bench.c provision.c
+ * Uso:         provision_bench [N]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "provision.h"
+
+#define PAGE_PROGRAM_MS 0.4         // programación de una página de 256 bytes, típico
+#define SECTOR_ERASE_MS 45.0        // borrado de un sector de 4 KB, típico
+#define BLOCK_ERASE_MS 150.0        // borrado de un bloque de 64 KB, típico
+#define LINE_MAX_LEN 64
+
+uint8_t host_flash[PICO_FLASH_SIZE_BYTES];
+
+static char* csv = NULL;
+static size_t csv_len = 0;
+static size_t csv_pos = 0;
+
+static unsigned long pages_programmed = 0;
+static unsigned long sectors_erased = 0;
+static unsigned long blocks_erased = 0;
+static unsigned long program_errors = 0;
+static int failures = 0;
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// --- Dependencias de provision.c ---
+
+absolute_time_t get_absolute_time(void) {
+    return (absolute_time_t)(now_s() * 1e6);
+}
+
+int64_t absolute_time_diff_us(absolute_time_t from, absolute_time_t to) {
+    return (int64_t)(to - from);
+}
+
+int getchar_timeout_us(uint32_t timeout_us) {
+    (void)timeout_us;
+    return csv_pos < csv_len ? (unsigned char)csv[csv_pos++] : PICO_ERROR_TIMEOUT;
+}
+
+/**
+ * @brief Borra como el SDK: bloques de 64 KB donde la alineación lo permite, sectores en el resto.
+ */
+void flash_range_erase(uint32_t flash_offs, size_t count) {
+    memset(host_flash + flash_offs, 0xFF, count);
+    while (count > 0) {
+        if (flash_offs % FLASH_BLOCK_BYTES == 0 && count >= FLASH_BLOCK_BYTES) {
+            blocks_erased++;
+            flash_offs += FLASH_BLOCK_BYTES;
+            count -= FLASH_BLOCK_BYTES;
+        } else {
+            sectors_erased++;
+            flash_offs += FLASH_SECTOR_SIZE;
+            count -= count < FLASH_SECTOR_SIZE ? count : FLASH_SECTOR_SIZE;
+        }
+    }
+}
+
+/**
+ * @brief Programa como una NOR: solo baja bits; programar sobre datos sin borrar es un error.
+ */
+void flash_range_program(uint32_t flash_offs, const uint8_t* data, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        if (host_flash[flash_offs + i] != 0xFF) {
+            program_errors++;
+        }
+        host_flash[flash_offs + i] &= data[i];
+    }
+    pages_programmed += count / FLASH_PAGE_SIZE;
+}
+
+void accounts_cache_invalidate(void) {
+}
+
+// --- Prueba ---
+
+static void check(bool ok, const char* what) {
+    if (!ok) {
+        printf("FALLO: %s\n", what);
+        failures++;
+    }
+}
+
+/**
+ * @brief Genera el CSV de `count` cuentas; `bad_line` > 0 repite un ID en esa línea.
+ */
+static void build_csv(size_t count, uint32_t first_id, size_t bad_line) {
+    free(csv);
+    csv = malloc(count * LINE_MAX_LEN + 3);
+    csv_len = 0;
+    csv_pos = 0;
+    for (size_t i = 0; i < count; i++) {
+        uint32_t id = first_id + (uint32_t)(i == bad_line && i > 0 ? i - 1 : i);
+        csv_len += (size_t)sprintf(csv + csv_len, "%06lu,%04lu,Cuenta %lu,%lu\n", (unsigned long)id,
+                                   (unsigned long)(i % 10000), (unsigned long)i,
+                                   10000ul * (1 + i % 50));
+    }
+    csv_len += (size_t)sprintf(csv + csv_len, ".\n");
+}
+
+/**
+ * @brief Comprueba que la tabla activa contenga exactamente las cuentas generadas.
+ */
+static void verify_table(size_t count, uint32_t first_id) {
+    check(provision_count() == count, "cantidad de cuentas activa");
+    for (size_t i = 0; i < count; i++) {
+        const ProvisionRecord* rec = provision_lookup(first_id + (uint32_t)i);
+        char password[PASSWORD_LENGTH + 1];
+        snprintf(password, sizeof(password), "%04lu", (unsigned long)(i % 10000));
+        if (rec == NULL || rec->balance != (int32_t)(10000 * (1 + i % 50)) ||
+            memcmp(rec->password, password, PASSWORD_LENGTH) != 0) {
+            check(false, "cuenta ausente o con datos incorrectos");
+            return;
+        }
+    }
+    check(provision_lookup(first_id - 1) == NULL, "cuenta inexistente encontrada (antes del rango)");
+    check(provision_lookup(first_id + (uint32_t)count) == NULL, "cuenta inexistente encontrada (después)");
+    check(provision_any_in_range(first_id, first_id), "rango con una cuenta");
+    check(!provision_any_in_range(first_id + (uint32_t)count, 999999), "rango vacío");
+}
+
+int main(int argc, char** argv) {
+    size_t count = argc > 1 ? strtoul(argv[1], NULL, 10) : PROVISION_MAX_RECORDS;
+    if (count < 2 || count > PROVISION_MAX_RECORDS) {
+        fprintf(stderr, "N debe estar entre 2 y %lu\n", (unsigned long)PROVISION_MAX_RECORDS);
+        return 2;
+    }
+
+    memset(host_flash, 0xFF, sizeof(host_flash));
+    provision_init();
+
+    // Primera carga, medida
+    build_csv(count, 100000, 0);
+    double start = now_s();
+    provision_receive();
+    double elapsed = now_s() - start;
+    verify_table(count, 100000);
+
+    double flash_ms = pages_programmed * PAGE_PROGRAM_MS + sectors_erased * SECTOR_ERASE_MS +
+                      blocks_erased * BLOCK_ERASE_MS;
+    printf("cuentas=%zu bytes=%zu anfitrion_s=%.3f anfitrion_cuentas_s=%.0f\n", count, csv_len, elapsed,
+           count / elapsed);
+    printf("paginas=%lu sectores=%lu bloques=%lu flash_estimada_ms=%.0f cuentas_s_limite_flash=%.0f\n",
+           pages_programmed, sectors_erased, blocks_erased, flash_ms, count / (flash_ms / 1000.0));
+
+    // Segunda carga: otro banco, y tras reiniciar gana la generación más reciente
+    build_csv(count / 2, 200000, 0);
+    provision_receive();
+    verify_table(count / 2, 200000);
+    provision_init();
+    verify_table(count / 2, 200000);
+
+    // Carga con un ID repetido a mitad: se rechaza y sigue la tabla anterior
+    build_csv(count, 300000, count / 2);
+    provision_receive();
+    verify_table(count / 2, 200000);
+    provision_init();
+    verify_table(count / 2, 200000);
+
+    check(program_errors == 0, "programación sobre flash sin borrar");
+    printf("fallos=%d\n", failures);
+    return failures ? 1 : 0;
+}
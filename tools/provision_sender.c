@@ -0,0 +1,203 @@
+/**
+ * @file provision_sender.c
+ * @brief Emisor de cuentas para el modo de aprovisionamiento (herramienta para Linux).
+ * 
+ * Envía un archivo CSV (`id,clave,nombre,saldo`) por el puerto USB CDC del terminal, ordenándolo
+ * antes por ID, o genera N cuentas sintéticas para medir el rendimiento de la carga. El terminal
+ * pide confirmar la carga: se muestra el código que hay que teclear en él seguido de '#'. Al
+ * terminar muestra el tiempo informado por el dispositivo y el medido en el anfitrión.
+ * 
+ * Compilación: cc -O2 -o provision_sender tools/provision_sender.c
+ * Uso:         provision_sender /dev/ttyACM0 cuentas.csv
+ *              provision_sender /dev/ttyACM0 --generate 20000
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#define LINE_MAX_LEN 128
+#define RESPONSE_TIMEOUT_S 90
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int open_port(const char* path) {
+    int fd = open(path, O_RDWR | O_NOCTTY);
+    if (fd < 0) {
+        perror(path);
+        return -1;
+    }
+    struct termios tio;
+    if (tcgetattr(fd, &tio) == 0) {
+        cfmakeraw(&tio);
+        tio.c_cc[VMIN] = 0;
+        tio.c_cc[VTIME] = 1;        // lecturas con espera de 100 ms
+        tcsetattr(fd, TCSANOW, &tio);
+    }
+    tcflush(fd, TCIOFLUSH);
+    return fd;
+}
+
+static int write_all(int fd, const char* buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, buf, len);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("write");
+            return -1;
+        }
+        buf += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+/**
+ * @brief Lee líneas del dispositivo hasta encontrar una que empiece con alguno de los prefijos.
+ */
+static int wait_for(int fd, const char* a, const char* b, char* out, size_t out_len) {
+    char line[LINE_MAX_LEN];
+    size_t len = 0;
+    double deadline = now_s() + RESPONSE_TIMEOUT_S;
+
+    while (now_s() < deadline) {
+        char c;
+        ssize_t n = read(fd, &c, 1);
+        if (n <= 0) {
+            continue;
+        }
+        if (c == '\n' || c == '\r') {
+            line[len] = '\0';
+            if ((a && strncmp(line, a, strlen(a)) == 0) || (b && strncmp(line, b, strlen(b)) == 0)) {
+                snprintf(out, out_len, "%s", line);
+                return 0;
+            }
+            len = 0;
+        } else if (len < sizeof(line) - 1) {
+            line[len++] = c;
+        }
+    }
+    fprintf(stderr, "sin respuesta del dispositivo\n");
+    return -1;
+}
+
+static int compare_lines(const void* a, const void* b) {
+    return strncmp(*(char* const*)a, *(char* const*)b, 6);
+}
+
+/**
+ * @brief Carga el archivo CSV en memoria y lo ordena por ID.
+ */
+static char** load_sorted(const char* path, size_t* count) {
+    FILE* f = fopen(path, "r");
+    if (!f) {
+        perror(path);
+        return NULL;
+    }
+    size_t cap = 1024;
+    char** lines = malloc(cap * sizeof(*lines));
+    char buf[LINE_MAX_LEN];
+    *count = 0;
+    while (fgets(buf, sizeof(buf), f)) {
+        buf[strcspn(buf, "\r\n")] = '\0';
+        if (buf[0] == '\0') {
+            continue;
+        }
+        if (*count == cap) {
+            cap *= 2;
+            lines = realloc(lines, cap * sizeof(*lines));
+        }
+        lines[(*count)++] = strdup(buf);
+    }
+    fclose(f);
+    qsort(lines, *count, sizeof(*lines), compare_lines);
+    return lines;
+}
+
+int main(int argc, char** argv) {
+    if (argc != 3 && argc != 4) {
+        fprintf(stderr, "uso: %s <puerto> <archivo.csv | --generate N>\n", argv[0]);
+        return 2;
+    }
+    int fd = open_port(argv[1]);
+    if (fd < 0) {
+        return 1;
+    }
+
+    size_t count = 0;
+    char** lines = NULL;
+    long generate = 0;
+    if (strcmp(argv[2], "--generate") == 0) {
+        generate = argc == 4 ? strtol(argv[3], NULL, 10) : 0;
+        if (generate <= 0 || generate > 899999) {
+            fprintf(stderr, "N debe estar entre 1 y 899999\n");
+            return 2;
+        }
+        count = (size_t)generate;
+    } else if ((lines = load_sorted(argv[2], &count)) == NULL) {
+        return 1;
+    }
+
+    char reply[LINE_MAX_LEN];
+    if (write_all(fd, "\nprovision\n", 11) < 0 || wait_for(fd, "CODE", "ERR", reply, sizeof(reply)) < 0) {
+        return 1;
+    }
+    if (strncmp(reply, "CODE", 4) == 0) {
+        fprintf(stderr, "teclee %s y '#' en el terminal\n", reply + 5);
+        if (wait_for(fd, "READY", "ERR", reply, sizeof(reply)) < 0) {
+            return 1;
+        }
+    }
+    if (strncmp(reply, "READY", 5) != 0) {
+        fprintf(stderr, "%s\n", reply);
+        return 1;
+    }
+
+    double start = now_s();
+    size_t bytes = 0;
+    char chunk[4096];
+    size_t fill = 0;
+    for (size_t i = 0; i < count; i++) {
+        char line[LINE_MAX_LEN];
+        int len;
+        if (generate) {
+            len = snprintf(line, sizeof(line), "%06lu,%04lu,Cuenta %lu,%lu\n",
+                           100000ul + i, i % 10000, i, 10000ul * (1 + i % 50));
+        } else {
+            len = snprintf(line, sizeof(line), "%s\n", lines[i]);
+        }
+        if (fill + (size_t)len > sizeof(chunk)) {
+            if (write_all(fd, chunk, fill) < 0) {
+                return 1;
+            }
+            fill = 0;
+        }
+        memcpy(chunk + fill, line, (size_t)len);
+        fill += (size_t)len;
+        bytes += (size_t)len;
+    }
+    memcpy(chunk + fill, ".\n", 2);
+    fill += 2;
+    if (write_all(fd, chunk, fill) < 0 || wait_for(fd, "OK", "ERR", reply, sizeof(reply)) < 0) {
+        return 1;
+    }
+    double elapsed = now_s() - start;
+
+    printf("%s\n", reply);
+    if (strncmp(reply, "OK", 2) != 0) {
+        return 1;
+    }
+    printf("%zu cuentas, %zu bytes en %.2f s: %.0f cuentas/s, %.1f KB/s\n",
+           count, bytes, elapsed, count / elapsed, bytes / elapsed / 1024.0);
+    return 0;
+}
@@ -0,0 +1,229 @@
+/**
+ * @file txn_fault.c
+ * @brief Prueba de inyección de fallos del retiro en dos fases (herramienta para Linux).
+ * 
+ * Compila `transaction.c` con las barreras de memoria convertidas en puntos de fallo: cada fase
+ * escrita en el registro de intenciones pasa por tres (entrada invalidada, campos escritos y suma
+ * de verificación escrita), y el pulso del motor es uno más. Para cada punto de cada retiro
+ * simula un reinicio justo ahí (las variables inicializadas vuelven a su valor y la RAM no
+ * inicializada se conserva), ejecuta `txn_recover()` y comprueba que:
+ * 
+ *  - el saldo y los billetes quedan como antes del retiro o con el retiro completo, nunca a medias;
+ *  - si el motor llegó a energizarse, el retiro queda confirmado;
+ *  - si la última fase completa es la preparación, la reserva se libera;
+ *  - un retiro confirmado queda anotado en el diario exactamente una vez (como recuperado si lo
+ *    confirmó la recuperación) y uno anulado no se anota;
+ *  - un reinicio durante la propia recuperación y una segunda recuperación no cambian el resultado;
+ *  - tras la recuperación, la secuencia no retrocede y un retiro nuevo se confirma.
+ * 
+ * Compilación: cc -O2 -Itools/host -I. -o txn_fault tools/txn_fault.c
+ * Uso:         txn_fault
+ */
+#include <setjmp.h>
+#include <stdio.h>
+
+static void fault_point(void);
+#define __compiler_memory_barrier() fault_point()
+#include "transaction.c"
+
+#define START_BALANCE 2000.0
+#define START_QUANTITY 10
+
+User users[NUM_USER_SLOTS];
+Denomination denominations[NUM_DENOMINATIONS];
+
+static jmp_buf reset_point;
+static int fault_at = 0;        // punto en el que se simula el reinicio (0 = ninguno)
+static int fault_count = 0;     // puntos atravesados desde que se armó el fallo
+static bool motor_started = false;
+static int journaled = 0;       // retiros anotados en el diario (la página pendiente sobrevive al reinicio)
+static int journaled_recovered = 0;
+static int failures = 0;
+
+static void fault_point(void) {
+    __asm__ volatile("" ::: "memory");
+    if (fault_at && ++fault_count == fault_at) {
+        fault_at = 0;
+        longjmp(reset_point, 1);
+    }
+}
+
+// --- Dependencias de transaction.c ---
+
+void mov_motors(int motor_pin) {
+    (void)motor_pin;
+    motor_started = true;
+    fault_point();              // reinicio con el motor energizado
+}
+
+void msg_send(MsgId id) {
+    (void)id;
+}
+
+void journal_log(JournalEvent event, uint32_t account, uint8_t detail, int32_t value) {
+    (void)account;
+    (void)detail;
+    (void)value;
+    journaled += event == JOURNAL_DISPENSE || event == JOURNAL_DISPENSE_RECOVERED;
+    journaled_recovered += event == JOURNAL_DISPENSE_RECOVERED;
+}
+
+uint32_t account_number(const User* user) {
+    return 100000u + (uint32_t)(user - users);
+}
+
+void gpio_init(uint gpio) {
+    (void)gpio;
+}
+
+void gpio_set_dir(uint gpio, bool out) {
+    (void)gpio;
+    (void)out;
+}
+
+void gpio_put(uint gpio, bool value) {
+    (void)gpio;
+    (void)value;
+}
+
+// --- Prueba ---
+
+/**
+ * @brief Simula el reinicio: solo las variables inicializadas del módulo vuelven a su valor.
+ */
+static void reboot(void) {
+    next_seq = 1;
+    next_txn_id = 1;
+}
+
+static void check(bool ok, const char* what, int denom, int point) {
+    if (!ok) {
+        printf("FALLO denominacion=%d punto=%d: %s\n", denom, point, what);
+        failures++;
+    }
+}
+
+/**
+ * @brief Ejecuta un retiro completo; devuelve false si la reserva no fue posible.
+ */
+static bool withdraw(int user, int denom) {
+    Txn txn;
+    if (!txn_prepare(&txn, user, denom)) {
+        return false;
+    }
+    txn_execute(&txn);
+    txn_commit(&txn);
+    return true;
+}
+
+/**
+ * @brief Prepara el libro de cuentas y un registro con historia previa (un retiro ya confirmado).
+ */
+static void setup(void) {
+    static const int amounts[NUM_DENOMINATIONS] = {20, 50, 100, 200};
+    memset(users, 0, sizeof(users));
+    for (int i = 0; i < NUM_DENOMINATIONS; i++) {
+        denominations[i].amount = amounts[i % 4];
+        denominations[i].quantity = START_QUANTITY;
+        denominations[i].pinselect = 20 + i;
+    }
+    users[0].balance = START_BALANCE;
+    users[1].balance = START_BALANCE;
+    txn_log_reset();
+    withdraw(1, 0);
+}
+
+/**
+ * @brief Reinicia en el punto `point` de un retiro de `denom` y comprueba la recuperación.
+ * 
+ * @return false si el retiro terminó antes de alcanzar el punto (no quedan puntos).
+ */
+static bool run_point(int denom, int point, int recovery_point) {
+    setup();
+    double amount = denominations[denom].amount;
+    double balance_before = users[0].balance;
+    int quantity_before = denominations[denom].quantity;
+    double other_balance = users[1].balance;
+    uint32_t seq_before = next_seq;
+    volatile bool completed = false;
+
+    motor_started = false;
+    journaled = 0;
+    journaled_recovered = 0;
+    fault_count = 0;
+    fault_at = point;
+    if (setjmp(reset_point) == 0) {
+        withdraw(0, denom);
+        completed = true;
+    }
+    fault_at = 0;
+    if (completed) {
+        return false;
+    }
+    reboot();
+
+    // Reinicio opcional durante la propia recuperación
+    TxnPhase phase;
+    if (recovery_point) {
+        fault_count = 0;
+        fault_at = recovery_point;
+        if (setjmp(reset_point) == 0) {
+            txn_recover();
+        }
+        fault_at = 0;
+        reboot();
+    }
+    phase = txn_recover();
+
+    bool energized = motor_started;
+    bool debited = users[0].balance == balance_before - amount &&
+                   denominations[denom].quantity == quantity_before - 1;
+    bool untouched = users[0].balance == balance_before && denominations[denom].quantity == quantity_before;
+
+    check(debited || untouched, "libro de cuentas a medias", denom, point);
+    check(!energized || debited, "motor energizado sin retiro confirmado", denom, point);
+    if (!recovery_point) {
+        check(phase != TXN_PREPARED || untouched, "reserva preparada sin liberar", denom, point);
+        check(phase != TXN_DISPENSING || debited, "entrega en curso sin confirmar", denom, point);
+        check(phase != TXN_DISPENSED || debited, "entrega terminada sin confirmar", denom, point);
+        check(journaled_recovered == (debited && phase != TXN_FREE ? 1 : 0),
+              "retiro recuperado sin marcar en el diario", denom, point);
+    }
+    check(users[1].balance == other_balance, "retiro previo alterado", denom, point);
+    check(journaled == (debited ? 1 : 0), "retiro anotado en el diario cero o dos veces", denom, point);
+
+    // Una segunda recuperación no encuentra nada pendiente
+    double balance = users[0].balance;
+    int quantity = denominations[denom].quantity;
+    reboot();
+    check(txn_recover() == TXN_FREE, "segunda recuperación con trabajo pendiente", denom, point);
+    check(users[0].balance == balance && denominations[denom].quantity == quantity,
+          "segunda recuperación cambió el libro", denom, point);
+
+    // El registro continúa tras la recuperación
+    check(next_seq >= seq_before, "secuencia retrocedió tras la recuperación", denom, point);
+    check(withdraw(0, denom), "retiro posterior rechazado", denom, point);
+    check(users[0].balance == balance - amount, "retiro posterior no aplicado", denom, point);
+    reboot();
+    check(txn_recover() == TXN_FREE, "retiro posterior quedó pendiente", denom, point);
+
+    printf("denominacion=%d punto=%2d fallo_recuperacion=%d fase=%d motor=%d resultado=%s\n", denom, point,
+           recovery_point, (int)phase, energized, debited ? "confirmado" : "anulado");
+    return true;
+}
+
+int main(void) {
+    int points = 0;
+
+    for (int denom = 0; denom < NUM_DENOMINATIONS; denom++) {
+        for (int point = 1; run_point(denom, point, 0); point++) {
+            points++;
+            for (int recovery_point = 1; recovery_point <= 3; recovery_point++) {
+                run_point(denom, point, recovery_point);
+            }
+        }
+    }
+
+    printf("puntos=%d fallos=%d\n", points, failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,180 @@
+/**
+ * @file transaction.c
+ * @brief Registro de intenciones y transacción de retiro en dos fases.
+ * 
+ * Regla de escritura anticipada: cada fase se añade al registro antes de modificar el libro de
+ * cuentas o mover el motor. Una entrada a medio escribir no pasa la suma de verificación y se
+ * ignora, por lo que la recuperación ve siempre la última fase completa.
+ */
+#include "transaction.h"
+#include "tcl.h"
+#include "pwm.h"
+#include "messages.h"
+#include "journal.h"
+
+/**
+ * @brief Registro circular de intenciones (sobrevive a un reinicio por watchdog).
+ */
+static TxnRecord __uninitialized_ram(txn_log)[TXN_LOG_SIZE];
+
+/**
+ * @brief Siguiente número de secuencia a escribir en el registro.
+ */
+static uint32_t next_seq = 1;
+
+/**
+ * @brief Siguiente identificador de transacción.
+ */
+static uint32_t next_txn_id = 1;
+
+/**
+ * @brief Calcula la suma de verificación de una entrada (todo menos el campo `check`).
+ */
+static uint32_t record_check(const TxnRecord* rec) {
+    const uint8_t* bytes = (const uint8_t*)rec;
+    uint32_t hash = 2166136261u;                     // FNV-1a
+    for (size_t i = 0; i < offsetof(TxnRecord, check); i++) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * @brief Añade al registro la fase indicada de la transacción.
+ * 
+ * La confirmación se anota en el diario en cuanto su entrada es válida, antes de cualquier otro
+ * punto de reinicio: si el reinicio llega antes, la recuperación la rehace y la anota como
+ * recuperada, de modo que cada retiro confirmado aparece una sola vez.
+ */
+static void log_phase(Txn* txn, TxnPhase phase, bool recovered) {
+    TxnRecord* rec = &txn_log[next_seq % TXN_LOG_SIZE];
+
+    rec->check = 0;                                  // invalida la entrada mientras se escribe
+    __compiler_memory_barrier();
+    rec->seq = next_seq;
+    rec->txn_id = txn->id;
+    rec->phase = (uint8_t)phase;
+    rec->user_index = txn->user_index;
+    rec->denomination_index = txn->denomination_index;
+    rec->recovered = recovered ? 1 : 0;
+    rec->quantity_before = txn->quantity_before;
+    rec->balance_before = txn->balance_before;
+    __compiler_memory_barrier();
+    rec->check = record_check(rec);
+    if (phase == TXN_COMMITTED) {
+        journal_log(recovered ? JOURNAL_DISPENSE_RECOVERED : JOURNAL_DISPENSE,
+                    account_number(&users[txn->user_index]), txn->denomination_index,
+                    (int32_t)denominations[txn->denomination_index].amount);
+    }
+    __compiler_memory_barrier();
+
+    next_seq++;
+    txn->phase = phase;
+}
+
+/**
+ * @brief Aplica al libro de cuentas el resultado del retiro a partir de las imágenes previas.
+ */
+static void apply_reservation(const Txn* txn) {
+    Denomination* selected = &denominations[txn->denomination_index];
+    users[txn->user_index].balance = txn->balance_before - selected->amount;
+    selected->quantity = txn->quantity_before - 1;
+}
+
+/**
+ * @brief Restaura las imágenes previas del saldo y de la cantidad de billetes.
+ */
+static void restore_before_images(const Txn* txn) {
+    users[txn->user_index].balance = txn->balance_before;
+    denominations[txn->denomination_index].quantity = txn->quantity_before;
+}
+
+void txn_log_reset() {
+    memset(txn_log, 0, sizeof(txn_log));
+    next_seq = 1;
+    next_txn_id = 1;
+}
+
+TxnPhase txn_recover() {
+    const TxnRecord* last = NULL;
+
+    for (int i = 0; i < NUM_DENOMINATIONS; i++) {
+        gpio_init(denominations[i].pinselect);
+        gpio_set_dir(denominations[i].pinselect, GPIO_OUT);
+        gpio_put(denominations[i].pinselect, 0);
+    }
+
+    // Un único recorrido acotado: la entrada válida con mayor secuencia es la última fase escrita.
+    for (int i = 0; i < TXN_LOG_SIZE; i++) {
+        const TxnRecord* rec = &txn_log[i];
+        if (rec->phase == TXN_FREE || rec->check != record_check(rec)) {
+            continue;
+        }
+        if (last == NULL || rec->seq > last->seq) {
+            last = rec;
+        }
+    }
+
+    if (last == NULL) {
+        txn_log_reset();
+        return TXN_FREE;
+    }
+
+    next_seq = last->seq + 1;
+    next_txn_id = last->txn_id + 1;
+
+    if (last->phase == TXN_COMMITTED || last->phase == TXN_ABORTED ||
+        last->user_index >= NUM_USER_SLOTS || last->denomination_index >= NUM_DENOMINATIONS) {
+        return TXN_FREE;
+    }
+
+    Txn txn = {
+        .id = last->txn_id,
+        .user_index = last->user_index,
+        .denomination_index = last->denomination_index,
+        .quantity_before = last->quantity_before,
+        .balance_before = last->balance_before,
+        .phase = (TxnPhase)last->phase,
+    };
+
+    if (txn.phase == TXN_PREPARED) {
+        // El motor no se movió: se libera la reserva.
+        restore_before_images(&txn);
+        log_phase(&txn, TXN_ABORTED, true);
+        msg_send(MSG_TXN_ABORTED);
+    } else {
+        // El motor ya fue energizado: se rehace el débito y se marca para conciliación.
+        apply_reservation(&txn);
+        log_phase(&txn, TXN_COMMITTED, true);
+        msg_send(MSG_TXN_RECOVERED);
+    }
+    return txn.phase;
+}
+
+bool txn_prepare(Txn* txn, int user_index, int denomination_index) {
+    Denomination* selected = &denominations[denomination_index];
+
+    if (selected->quantity < 1 || selected->amount > users[user_index].balance) {
+        return false;
+    }
+
+    txn->id = next_txn_id++;
+    txn->user_index = (uint8_t)user_index;
+    txn->denomination_index = (uint8_t)denomination_index;
+    txn->quantity_before = selected->quantity;
+    txn->balance_before = users[user_index].balance;
+
+    log_phase(txn, TXN_PREPARED, false);
+    apply_reservation(txn);
+    return true;
+}
+
+void txn_execute(Txn* txn) {
+    log_phase(txn, TXN_DISPENSING, false);
+    mov_motors(denominations[txn->denomination_index].pinselect);
+    log_phase(txn, TXN_DISPENSED, false);
+}
+
+void txn_commit(Txn* txn) {
+    log_phase(txn, TXN_COMMITTED, false);
+}
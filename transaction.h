@@ -0,0 +1,103 @@
+/**
+ * @file transaction.h
+ * @brief Transacción atómica de retiro en dos fases entre el libro de cuentas y el dispensador.
+ * 
+ * Un retiro pasa por preparar (reserva de saldo y billete), ejecutar (dispensar) y confirmar o
+ * anular. Cada fase se registra antes de aplicarse en un registro de intenciones que vive en RAM
+ * no inicializada, de modo que tras un reinicio basta un único recorrido acotado del registro para
+ * dejar el libro de cuentas y los casetes en un estado coherente.
+ */
+#ifndef TRANSACTION_H
+#define TRANSACTION_H
+
+#include "pico/stdlib.h"
+
+/**
+ * @brief Número de entradas del registro circular de intenciones.
+ */
+#define TXN_LOG_SIZE 16
+
+/**
+ * @brief Fases de una transacción de retiro.
+ */
+typedef enum {
+    TXN_FREE = 0,        /**< Entrada sin usar */
+    TXN_PREPARED,        /**< Saldo y billete reservados, motor aún sin mover */
+    TXN_DISPENSING,      /**< Motor energizado, resultado físico incierto */
+    TXN_DISPENSED,       /**< Motor detenido, billete entregado */
+    TXN_COMMITTED,       /**< Retiro confirmado */
+    TXN_ABORTED          /**< Retiro anulado y reserva liberada */
+} TxnPhase;
+
+/**
+ * @brief Entrada del registro de intenciones.
+ * 
+ * Guarda las imágenes previas del saldo y de la cantidad de billetes, por lo que rehacer o
+ * deshacer la transacción es idempotente.
+ */
+typedef struct {
+    uint32_t seq;                 /**< Número de secuencia de la entrada */
+    uint32_t txn_id;              /**< Identificador de la transacción */
+    uint8_t phase;                /**< Fase registrada (`TxnPhase`) */
+    uint8_t user_index;           /**< Índice del usuario en `users` */
+    uint8_t denomination_index;   /**< Índice de la denominación en `denominations` */
+    uint8_t recovered;            /**< 1 si la fase fue resuelta durante la recuperación */
+    int32_t quantity_before;      /**< Billetes disponibles antes del retiro */
+    double balance_before;        /**< Saldo del usuario antes del retiro */
+    uint32_t check;               /**< Suma de verificación de la entrada */
+} TxnRecord;
+
+/**
+ * @brief Transacción de retiro en curso.
+ */
+typedef struct {
+    uint32_t id;                  /**< Identificador de la transacción */
+    uint8_t user_index;           /**< Índice del usuario */
+    uint8_t denomination_index;   /**< Índice de la denominación */
+    int32_t quantity_before;      /**< Imagen previa de la cantidad de billetes */
+    double balance_before;        /**< Imagen previa del saldo */
+    TxnPhase phase;               /**< Fase actual */
+} Txn;
+
+/**
+ * @brief Vacía el registro de intenciones (arranque en frío).
+ */
+void txn_log_reset(void);
+
+/**
+ * @brief Resuelve la última transacción incompleta tras un reinicio.
+ * 
+ * Recorre una sola vez las `TXN_LOG_SIZE` entradas. Una transacción solo preparada se anula;
+ * una que ya energizó el motor se confirma y se marca como recuperada para la conciliación, y se
+ * anota en el diario como `JOURNAL_DISPENSE_RECOVERED` (el diario debe estar inicializado).
+ * Además apaga todos los motores.
+ * 
+ * @return Fase final de la transacción resuelta, o `TXN_FREE` si no había ninguna pendiente.
+ */
+TxnPhase txn_recover(void);
+
+/**
+ * @brief Fase 1: registra la intención y reserva saldo y billete.
+ * 
+ * @param txn Transacción a preparar.
+ * @param user_index Índice del usuario que retira.
+ * @param denomination_index Índice de la denominación elegida.
+ * @return true si la reserva fue posible (saldo y billetes suficientes).
+ */
+bool txn_prepare(Txn* txn, int user_index, int denomination_index);
+
+/**
+ * @brief Fase 2: dispensa el billete reservado.
+ * 
+ * @param txn Transacción preparada.
+ */
+void txn_execute(Txn* txn);
+
+/**
+ * @brief Confirma una transacción ya dispensada y la anota en el diario como `JOURNAL_DISPENSE`.
+ * 
+ * @param txn Transacción dispensada.
+ */
+void txn_commit(Txn* txn);
+
+#endif // TRANSACTION_H
@@ -0,0 +1,226 @@
+/**
+ * @file usb_cmd.c
+ * @brief Lectura no bloqueante y despacho de comandos de servicio por USB.
+ */
+#include "usb_cmd.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pico/stdio_usb.h"
+#include "pico/rand.h"
+#include "hardware/watchdog.h"
+#include "main.h"
+#include "tcl.h"
+#include "keybuf.h"
+#include "deferred.h"
+#include "metrics.h"
+#include "messages.h"
+#include "provision.h"
+#include "irqlog.h"
+#include "journal.h"
+#include "memstat.h"
+
+/**
+ * @brief Manejador de un comando; recibe el texto que sigue al nombre (puede ser vacío).
+ */
+typedef void (*UsbCmdHandler)(const char* args);
+
+/**
+ * @brief Entrada de la tabla de comandos.
+ */
+typedef struct {
+    const char* name;         /**< Nombre del comando */
+    UsbCmdHandler handler;    /**< Función que lo atiende */
+    const char* help;         /**< Descripción breve */
+} UsbCmd;
+
+static void cmd_help(const char* args);
+
+/**
+ * @brief Exporta las métricas en texto o, con el argumento `bin`, en binario.
+ */
+static void cmd_metrics(const char* args) {
+    if (strcmp(args, "bin") == 0) {
+        metrics_export_binary();
+    } else {
+        metrics_export_text();
+    }
+}
+
+/**
+ * @brief Cambia el idioma de los mensajes (`es` o `en`).
+ */
+static void cmd_lang(const char* args) {
+    if (strcmp(args, "es") == 0) {
+        msg_set_language(MSG_LANG_ES);
+    } else if (strcmp(args, "en") == 0) {
+        msg_set_language(MSG_LANG_EN);
+    } else {
+        printf("\nuso: lang es|en\n");
+    }
+}
+
+/**
+ * @brief Pide confirmar la carga de cuentas con un código tecleado en el terminal.
+ * 
+ * El código se envía solo por USB y debe ingresarse en el teclado, así que reemplazar las cuentas
+ * exige a la vez el acceso USB y presencia física. Solo se pide con el terminal en reposo.
+ * 
+ * @return true si se tecleó el código correcto seguido de '#' antes del plazo.
+ */
+static bool provision_confirmed(void) {
+    if (!session_idle()) {
+        printf("ERR 0 terminal en uso\n");
+        return false;
+    }
+
+    uint32_t code = get_rand_32() % 10000;
+    uint32_t entered = 0;
+    int digits = 0;
+    bool confirmed = false;
+    absolute_time_t deadline = make_timeout_time_ms(PROVISION_CONFIRM_TIMEOUT_MS);
+
+    keybuf_flush();
+    msg_send(MSG_PROVISION_CONFIRM);
+    printf("CODE %0*lu\n", PROVISION_CONFIRM_DIGITS, (unsigned long)code);
+    while (!time_reached(deadline)) {
+        watchdog_update();
+        deferred_run();                 // decodifica las teclas del escaneo
+        KeyEvent ev;
+        if (!keybuf_pop(&ev)) {
+            sleep_ms(MAIN_LOOP_PERIOD_MS);
+            continue;
+        }
+        if (ev.key == '#') {
+            confirmed = digits == PROVISION_CONFIRM_DIGITS && entered == code;
+            break;
+        }
+        if (ev.key < '0' || ev.key > '9' || ++digits > PROVISION_CONFIRM_DIGITS) {
+            break;
+        }
+        entered = entered * 10 + (uint32_t)(ev.key - '0');
+    }
+    if (!confirmed) {
+        printf("ERR 0 sin confirmar\n");
+    }
+    return confirmed;
+}
+
+/**
+ * @brief Recibe un archivo de cuentas CSV tras confirmarlo en el terminal (ver `provision.h`).
+ */
+static void cmd_provision(const char* args) {
+    if (provision_confirmed()) {
+        provision_receive();
+    }
+    if (session_idle()) {
+        keybuf_flush();                 // las teclas de la confirmación no son un ID
+        msg_send(MSG_ENTER_ID);         // vuelve a la pantalla de bienvenida
+    }
+}
+
+/**
+ * @brief Estado del registro de interrupciones, `bin` para su exportación binaria o `restart`
+ * para volver a grabar desde el próximo reposo.
+ */
+static void cmd_irqlog(const char* args) {
+    if (strcmp(args, "bin") == 0) {
+        irqlog_export_binary();
+    } else if (strcmp(args, "restart") == 0) {
+        irqlog_restart();
+        irqlog_export_text();
+    } else {
+        irqlog_export_text();
+    }
+}
+
+/**
+ * @brief Diario de eventos: estado, `export [desde [hasta]]` o `bench <registros>`.
+ */
+static void cmd_journal(const char* args) {
+    if (strncmp(args, "export", 6) == 0) {
+        char* end;
+        unsigned long from = strtoul(args + 6, &end, 10);
+        unsigned long to = strtoul(end, &end, 10);
+        journal_export_start((uint32_t)from, to ? (uint32_t)to : JOURNAL_SEQ_END - 1);
+    } else if (strncmp(args, "bench", 5) == 0) {
+        journal_bench((uint32_t)strtoul(args + 5, NULL, 10));
+    } else {
+        journal_export_text();
+    }
+}
+
+/**
+ * @brief Uso de memoria: secciones, pilas, montículo y tablas estáticas.
+ */
+static void cmd_mem(const char* args) {
+    memstat_export_text();
+}
+
+/**
+ * @brief Tabla de comandos disponibles.
+ */
+static const UsbCmd commands[] = {
+    {"help", cmd_help, "lista los comandos"},
+    {"metrics", cmd_metrics, "metricas operativas [bin]"},
+    {"lang", cmd_lang, "idioma de los mensajes es|en"},
+    {"provision", cmd_provision, "carga masiva de cuentas CSV"},
+    {"irqlog", cmd_irqlog, "registro de interrupciones del teclado [bin | restart]"},
+    {"journal", cmd_journal, "diario de eventos [export desde hasta | bench n]"},
+    {"mem", cmd_mem, "uso de memoria y marcas de agua de las pilas"},
+};
+
+static void cmd_help(const char* args) {
+    for (size_t i = 0; i < count_of(commands); i++) {
+        printf("%s - %s\n", commands[i].name, commands[i].help);
+    }
+}
+
+/**
+ * @brief Línea en construcción y su longitud.
+ */
+static char line[USB_CMD_LINE_MAX];
+static size_t line_len = 0;
+
+/**
+ * @brief Separa el nombre del comando de sus argumentos y ejecuta el manejador.
+ */
+static void dispatch(char* text) {
+    char* args = strchr(text, ' ');
+    if (args != NULL) {
+        *args++ = '\0';
+    } else {
+        args = text + strlen(text);
+    }
+    if (text[0] == '\0') {
+        return;
+    }
+    for (size_t i = 0; i < count_of(commands); i++) {
+        if (strcmp(text, commands[i].name) == 0) {
+            commands[i].handler(args);
+            return;
+        }
+    }
+    printf("\ncomando desconocido: %s\n", text);
+}
+
+void usb_cmd_poll() {
+    for (int i = 0; i < USB_CMD_CHARS_PER_POLL; i++) {
+        int c = getchar_timeout_us(0);
+        if (c == PICO_ERROR_TIMEOUT) {
+            return;
+        }
+        if (c == '\r' || c == '\n') {
+            line[line_len] = '\0';
+            line_len = 0;
+            dispatch(line);
+        } else if (line_len < USB_CMD_LINE_MAX - 1) {
+            line[line_len++] = (char)c;
+        }
+    }
+}
+
+void usb_cmd_write_binary(const void* data, size_t len) {
+    fflush(stdout);
+    stdio_usb.out_chars((const char*)data, (int)len);
+}
@@ -0,0 +1,43 @@
+/**
+ * @file usb_cmd.h
+ * @brief Canal de comandos de servicio por USB CDC.
+ * 
+ * Lee líneas de la entrada estándar USB sin bloquear y las despacha a los subsistemas
+ * (por ejemplo `metrics` o `metrics bin`). Convive con la salida de la sesión del usuario.
+ */
+#ifndef USB_CMD_H
+#define USB_CMD_H
+
+#include "pico/stdlib.h"
+
+/**
+ * @brief Longitud máxima de una línea de comando, incluido el terminador.
+ */
+#define USB_CMD_LINE_MAX 64
+
+/**
+ * @brief Máximo de caracteres leídos por llamada, para no retener el bucle principal.
+ */
+#define USB_CMD_CHARS_PER_POLL 32
+
+/**
+ * @brief Lee los caracteres disponibles y ejecuta el comando cuando llega un fin de línea.
+ * 
+ * Debe llamarse en cada iteración del bucle principal.
+ */
+void usb_cmd_poll(void);
+
+/**
+ * @brief Escribe bytes binarios por USB tal cual.
+ * 
+ * La salida estándar del SDK inserta un retorno de carro antes de cada salto de línea, lo que
+ * corrompe cualquier byte 0x0A de una exportación binaria. Esta función vacía primero el texto
+ * pendiente de la salida estándar y luego entrega los bytes directamente al controlador USB,
+ * sin traducción.
+ * 
+ * @param data Bytes a enviar.
+ * @param len Número de bytes.
+ */
+void usb_cmd_write_binary(const void* data, size_t len);
+
+#endif // USB_CMD_H